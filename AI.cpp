@@ -0,0 +1,174 @@
+#include<atomic>
+#include<algorithm>
+#include<chrono>
+#include<cmath>
+#include<mutex>
+#include<vector>
+#include"AI.h"
+#include"Scheduler.h"
+#include"Sim.h"
+#include"Physics.h"
+
+using namespace std;
+
+typedef chrono::steady_clock Clock;
+
+namespace {
+
+// A point in the search space and how close it came
+struct Candidate {
+  double speed;
+  double angle;
+  double miss;
+  bool hit;
+  bool finished;     // Flown to the end, not cut off when the search ended
+};
+
+bool closer(const Candidate & a, const Candidate & b) {
+  return a.miss < b.miss;
+}
+
+// Everything the search threads share
+struct Search {
+  const Layout * layout;
+  int shooter;
+  int target;
+  Clock::time_point deadline;
+  atomic<bool> done;         // Set on the first hit, or when time runs out
+  atomic<int> shots;
+};
+
+const int CHECKEVERY = 128;   // Steps between deadline checks inside a shot
+
+// Flies one shot and measures its closest approach to the target
+// planet's surface, in the same units as the collision check.
+// Gives up early if the search is over, leaving it unfinished.
+Candidate tryshot(Search & search, double speed, double angle) {
+  Candidate c;
+  c.speed = speed;
+  c.angle = angle;
+  c.hit = false;
+  c.finished = false;
+  c.miss = HUGE_VAL;
+
+  const BodyStore & planets = search.layout->planets;
+  double tx = planets.getx(search.target);
+  double ty = planets.gety(search.target);
+  double trad = planets.getradius(search.target);
+
+  Shot shot(*search.layout, speed, angle, search.shooter);
+  while (shot.getsteps() < MAXSTEPS) {
+    int outcome = shot.step();
+    const Missile & m = shot.getmissile();
+    double dx = (m.getx() - tx) / ASPECT;
+    double dy = m.gety() - ty;
+    c.miss = fmin(c.miss, sqrt(dx * dx + dy * dy) - trad);
+    if (outcome != SHOT_FLYING) {
+      c.hit = (outcome == SHOT_HIT && shot.gethit() == search.target);
+      c.finished = true;
+      break;
+    }
+    if (shot.getsteps() % CHECKEVERY == 0 && (search.done || Clock::now() >= search.deadline))
+      break;
+  }
+  if (shot.getsteps() >= MAXSTEPS)
+    c.finished = true;           // Timed out like a real shot would
+  if (c.hit)
+    c.miss = 0;
+  ++search.shots;
+  return c;
+}
+
+// Evaluates a grid of nangles by nspeeds shots centered on (speed,
+// angle), spread over the given spans. Rows of angles are handed
+// out to the pool's threads. Shots cut off when the search ended are
+// dropped: only part of their path was seen, so their miss distance
+// would flatter them.
+void searchgrid(Search & search, double speed, double angle, double speedspan, double anglespan,
+                int nspeeds, int nangles, TaskPool & pool, vector<Candidate> & found) {
+  mutex lock;
+  pool.run(nangles, [&](int a) {
+    if (search.done)
+      return;
+    double ang = angle - anglespan / 2 + anglespan * (a + 0.5) / nangles;
+    ang = fmod(ang + 360, 360);
+    vector<Candidate> local;
+    for (int s = 0; s < nspeeds && !search.done; ++s) {
+      double sp = speed - speedspan / 2 + speedspan * (s + 0.5) / nspeeds;
+      if (sp < 0 || sp > 10)
+        continue;
+      Candidate c = tryshot(search, sp, ang);
+      if (c.finished)
+        local.push_back(c);
+      if (c.hit)
+        search.done = true;   // Early out for every thread
+      if (Clock::now() >= search.deadline)
+        search.done = true;
+    }
+    lock_guard<mutex> guard(lock);
+    found.insert(found.end(), local.begin(), local.end());
+  });
+}
+
+}
+
+AIShot aimshot(const Layout & layout, int shooter, int budgetms, int threads) {
+  Search search;
+  search.layout = &layout;
+  search.shooter = shooter;
+  search.target = (shooter == 0 ? 1 : 0);
+  search.deadline = Clock::now() + chrono::milliseconds(budgetms);
+  search.done = false;
+  search.shots = 0;
+
+  // Until something better turns up, aim straight at the target.
+  // A screen step of (dx, dy) needs a velocity of (dx, 2 dy).
+  const BodyStore & planets = layout.planets;
+  double dx = planets.getx(search.target) - planets.getx(shooter);
+  double dy = planets.gety(search.target) - planets.gety(shooter);
+  Candidate best;
+  best.speed = 5;
+  best.angle = fmod(atan2(2 * dy, dx) * 180 / PI + 360, 360);
+  best.miss = HUGE_VAL;
+  best.hit = false;
+  best.finished = false;
+
+  // Coarse pass over the whole range, then zoom in around the few
+  // closest misses, a quarter of the span at a time
+  const int KEEP = 4;
+  vector<Candidate> seeds(1, best);
+  double speedspan = 10, anglespan = 360;
+  int nspeeds = 10, nangles = 72;
+  TaskPool pool(threads);       // Started once; every pass below reuses it
+  searchgrid(search, 5, 180, speedspan, anglespan, nspeeds, nangles, pool, seeds);
+
+  while (!search.done) {
+    sort(seeds.begin(), seeds.end(), closer);
+    if (seeds.size() > (size_t)KEEP)
+      seeds.resize(KEEP);
+    speedspan /= 4;
+    anglespan /= 4;
+    if (anglespan < 1e-6)
+      break;             // Nothing left to refine
+    vector<Candidate> next(seeds);
+    for (size_t k = 0; k < seeds.size() && !search.done; ++k) {
+      searchgrid(search, seeds[k].speed, seeds[k].angle, speedspan, anglespan, 6, 8, pool, next);
+    }
+    seeds.swap(next);
+  }
+
+  for (size_t k = 0; k < seeds.size(); ++k) {
+    if (seeds[k].hit || seeds[k].miss < best.miss)
+      best = seeds[k];
+    if (best.hit)
+      break;
+  }
+
+  AIShot result;
+  result.speed = best.speed;
+  result.angle = best.angle;
+  result.hit = best.hit;
+  result.miss = best.miss;
+  result.shots = search.shots;
+  return result;
+}
@@ -0,0 +1,22 @@
+#ifndef AI_H
+#define AI_H
+
+struct Layout;
+
+// The shot the computer settled on
+struct AIShot {
+  double speed;
+  double angle;      // Degrees
+  bool hit;          // True if the shot hits the target planet
+  double miss;       // Closest the shot came to the target's surface
+  int shots;         // Trajectories tried
+};
+
+// Searches for a shot from planet "shooter" that hits the other
+// player's planet. Starts with a coarse grid over every angle and
+// speed, then refines around the closest misses. Stops as soon as any
+// thread finds a hit, and always returns within about budgetms
+// milliseconds with the best shot found so far.
+AIShot aimshot(const Layout &, int, int, int = 0);
+
+#endif
@@ -1,65 +1,55 @@
+#ifndef BODY_H
+#define BODY_H
+
+class BodyStore;
+class QuadTree;
+class FieldGrid;
+
 class Body {
 
 
   public:
 
-    void Construct(double, double);
-
     // retrieve protected information
     double getx() const;
     double gety() const;
+    int getcellx() const;    // Screen cell the body is drawn in
+    int getcelly() const;
+    double getvx() const;
+    double getvy() const;
     int getsize() const;
     double getmass() const;
 
-    // Manipulate "string" of bodies
-    void setnext(Body *);
-    Body * getnext() const;
-
     // Functions that set physics
-    void getforce(const Body *, double *) const;
+    void getforce(const BodyStore &, double *, int) const;   // Under a ForceLawKind
+    void getforce(const QuadTree &, double *, int) const;
+    void getforce(const FieldGrid &, double *) const;
     void setvelocity(const double *);
     void movebody();
-
-    // Display functions
-    void printbody() const;
-    void erasebody() const;
+    void setstate(double, double, double, double);   // Position and velocity, for the integrators
 
 
   protected:
 
-    double vtheta; // Angle in degrees counterclockwise from x+ of velocity
-    double vmag;  // Magnitude of velocity in units per frame
+    void setcell();
+
+    double vx;  // Velocity components in units per frame
+    double vy;
 
-    int x;
-    int y;
+    double x;   // Position, kept to sub-cell precision for the physics
+    double y;
+    int cellx;  // Screen cell containing (x, y), used for drawing
+    int celly;
     int size;
 
     double mass;
-    Body * nextBody;
-
-};
 
-class Asteroid : public Body {
-
-  public:
-    Asteroid(double, double);
-    Asteroid(double, double, int);
-
-};
-
-class Planet : public Body {
-
-  public:
-    Planet(double, double);
-    Planet(double, double, int);
 };
 
 class Missile : public Body {
 
   public:
-    Missile(const Body *, double, double, double);
-
-    void printbody() const;
-    void erasebody() const;
+    Missile(double, double, double, double, double);
 };
 
+#endif
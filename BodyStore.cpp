@@ -0,0 +1,74 @@
+#include"BodyStore.h"
+#include"Physics.h"
+
+BodyStore::BodyStore() {
+}
+
+// Adds a body centered at (x0, y0). The mass of a body comes from
+// its size.
+int BodyStore::add(double x0, double y0, int s) {
+  this->x.push_back(x0);
+  this->y.push_back(y0);
+  this->size.push_back(s);
+  this->mass.push_back(bodymass(s));
+  this->radius.push_back(s / 2);   // size is the diameter; integer division matches the collision check
+  return this->x.size() - 1;
+}
+
+void BodyStore::clear() {
+  this->x.clear();
+  this->y.clear();
+  this->size.clear();
+  this->mass.clear();
+  this->radius.clear();
+}
+
+// Grows the arrays ahead of time so a layout of n bodies
+// is built without reallocating
+void BodyStore::reserve(int n) {
+  this->x.reserve(n);
+  this->y.reserve(n);
+  this->size.reserve(n);
+  this->mass.reserve(n);
+  this->radius.reserve(n);
+}
+
+int BodyStore::count() const {
+  return this->x.size();
+}
+
+double BodyStore::getx(int i) const {
+  return this->x[i];
+}
+
+double BodyStore::gety(int i) const {
+  return this->y[i];
+}
+
+int BodyStore::getsize(int i) const {
+  return this->size[i];
+}
+
+double BodyStore::getmass(int i) const {
+  return this->mass[i];
+}
+
+double BodyStore::getradius(int i) const {
+  return this->radius[i];
+}
+
+const double * BodyStore::xdata() const {
+  return this->x.data();
+}
+
+const double * BodyStore::ydata() const {
+  return this->y.data();
+}
+
+const double * BodyStore::massdata() const {
+  return this->mass.data();
+}
+
+const double * BodyStore::raddata() const {
+  return this->radius.data();
+}
@@ -0,0 +1,46 @@
+#ifndef BODYSTORE_H
+#define BODYSTORE_H
+
+#include <vector>
+
+// Holds every body on the field in contiguous arrays, one array
+// per property, so the physics and collision passes can walk the
+// bodies linearly instead of chasing pointers.
+class BodyStore {
+
+
+  public:
+
+    BodyStore();
+
+    // Manage the set of bodies
+    int add(double, double, int);   // Returns the index of the new body
+    void clear();
+    void reserve(int);
+    int count() const;
+
+    // retrieve information about body i
+    double getx(int) const;
+    double gety(int) const;
+    int getsize(int) const;
+    double getmass(int) const;
+    double getradius(int) const;
+
+    // Raw arrays for the physics passes
+    const double * xdata() const;
+    const double * ydata() const;
+    const double * massdata() const;
+    const double * raddata() const;
+
+
+  protected:
+
+    std::vector<double> x;
+    std::vector<double> y;
+    std::vector<double> mass;
+    std::vector<double> radius;  // Collision radius, in lines
+    std::vector<int> size;       // Diameter, in lines
+
+};
+
+#endif
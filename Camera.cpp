@@ -0,0 +1,69 @@
+#include<cmath>
+#include"Camera.h"
+
+Camera::Camera() {
+  this->worldlines = 0;
+  this->worldcols = 0;
+  this->view.x = 0;
+  this->view.y = 0;
+  this->view.lines = 0;
+  this->view.cols = 0;
+  this->view.top = 0;
+  this->view.left = 0;
+}
+
+void Camera::setworld(int lines, int cols) {
+  this->worldlines = lines;
+  this->worldcols = cols;
+  this->clamp();
+}
+
+void Camera::setwindow(int top, int left, int lines, int cols) {
+  this->view.top = top;
+  this->view.left = left;
+  this->view.lines = lines;
+  this->view.cols = cols;
+  this->clamp();
+}
+
+// Keeps the window inside the world, or at its top left corner if
+// the world is smaller
+void Camera::clamp() {
+  int maxx = this->worldcols - this->view.cols;
+  int maxy = this->worldlines - this->view.lines;
+  this->view.x = (this->view.x > maxx ? maxx : this->view.x);
+  this->view.y = (this->view.y > maxy ? maxy : this->view.y);
+  this->view.x = (this->view.x < 0 ? 0 : this->view.x);
+  this->view.y = (this->view.y < 0 ? 0 : this->view.y);
+}
+
+void Camera::center(double x, double y) {
+  this->view.x = (int)floor(x) - this->view.cols / 2;
+  this->view.y = (int)floor(y) - this->view.lines / 2;
+  this->clamp();
+}
+
+void Camera::pan(int dx, int dy) {
+  this->view.x += dx;
+  this->view.y += dy;
+  this->clamp();
+}
+
+bool Camera::follow(double x, double y) {
+  int cx = floor(x) - this->view.x;
+  int cy = floor(y) - this->view.y;
+  if (cx >= this->view.cols / 4 && cx < this->view.cols - this->view.cols / 4
+      && cy >= this->view.lines / 4 && cy < this->view.lines - this->view.lines / 4)
+    return false;
+  int oldx = this->view.x, oldy = this->view.y;
+  this->center(x, y);
+  return this->view.x != oldx || this->view.y != oldy;
+}
+
+bool Camera::scrolls() const {
+  return this->worldcols > this->view.cols || this->worldlines > this->view.lines;
+}
+
+const Viewport & Camera::getview() const {
+  return this->view;
+}
@@ -0,0 +1,52 @@
+#ifndef CAMERA_H
+#define CAMERA_H
+
+// Which part of the world is on screen, and where. World cell
+// (x + i, y + j) is drawn at screen cell (left + i, top + j), for i
+// below cols and j below lines; anything else isn't drawn.
+struct Viewport {
+  int x, y;             // World cell shown in the top left corner
+  int lines, cols;      // Size of the window, in cells
+  int top, left;        // Screen cell the window starts at
+};
+
+// A window onto a playing field that may be bigger than the terminal.
+// The window never shows anything past the world's edges; a world
+// no bigger than the window just sits in its top left corner and the
+// camera never moves.
+class Camera {
+
+
+  public:
+
+    Camera();
+
+    void setworld(int, int);              // World size, lines then cols
+    void setwindow(int, int, int, int);   // Screen rectangle: top, left, lines, cols
+
+    // Puts world point (x, y) as near the middle of the window as
+    // the world's edges allow
+    void center(double, double);
+
+    // Moves the window by the given number of cells
+    void pan(int, int);
+
+    // Keeps a moving point in view. If (x, y) has left the middle
+    // half of the window, centers on it. Returns whether the window
+    // moved, in which case everything on screen needs redrawing.
+    bool follow(double, double);
+
+    bool scrolls() const;                 // Whether the world is bigger than the window
+    const Viewport & getview() const;
+
+
+  protected:
+
+    void clamp();
+
+    int worldlines, worldcols;
+    Viewport view;
+
+};
+
+#endif
@@ -0,0 +1,208 @@
+#include<ncurses.h>
+#include<cstdio>
+#include<cstring>
+#include<vector>
+#include"Display.h"
+#include"Body.h"
+#include"BodyStore.h"
+#include"SpatialHash.h"
+#include"Camera.h"
+#include"Sprites.h"
+#include"Profile.h"
+
+// The draw functions below only change ncurses' copy of the screen.
+// Nothing reaches the terminal until presentframe(), so a whole
+// frame goes out in one write.
+
+static long framecount = 0;
+static long startbytes = 0;
+static long startwrites = 0;
+
+static const int UNBOUNDED = 1 << 29;
+static Viewport view = {0, 0, UNBOUNDED, UNBOUNDED, 0, 0};   // No camera: world cells are screen cells
+static std::vector<int> visible;                           // Scratch for printvisible, kept between frames
+
+// Reads the bytes and write calls this process has made so far from
+// /proc/self/io. Nearly all of them are terminal output. Leaves the
+// values alone where /proc isn't available.
+static void readio(long * bytes, long * writes) {
+  FILE * io = fopen("/proc/self/io", "r");
+  if (!io)
+    return;
+  char key[32];
+  long value;
+  while (fscanf(io, "%31[^:]: %ld\n", key, &value) == 2) {
+    if (!strcmp(key, "wchar"))
+      *bytes = value;
+    else if (!strcmp(key, "syscw"))
+      *writes = value;
+  }
+  fclose(io);
+}
+
+void startdisplay() {
+  readio(&startbytes, &startwrites);
+  initscr();
+}
+
+void startnulldisplay(int nlines, int ncols) {
+  FILE * out = fopen("/dev/null", "w");
+  FILE * in = fopen("/dev/null", "r");
+  readio(&startbytes, &startwrites);
+  newterm((char *)"xterm", out, in);     // The same terminal everywhere, so output sizes compare between runs
+  resizeterm(nlines, ncols);
+}
+
+void presentframe() {
+  PROFILE_SCOPE(PROF_PRESENT);
+  wnoutrefresh(stdscr);
+  doupdate();
+  ++framecount;
+}
+
+void displaystats(long * frames, long * bytes, long * writes) {
+  long b = startbytes, w = startwrites;
+  readio(&b, &w);
+  *frames = framecount;
+  *bytes = b - startbytes;
+  *writes = w - startwrites;
+}
+
+void setviewport(const Viewport & v) {
+  view = v;
+}
+
+void clearview() {
+  PROFILE_SCOPE(PROF_DRAW);
+  for (int j = 0; j < view.lines; ++j)
+    mvhline(view.top + j, view.left, ' ', view.cols);
+}
+
+// Moves world cell (x, y) to the screen. Returns false if it isn't
+// in the window.
+static bool toscreen(int * x, int * y) {
+  int i = *x - view.x, j = *y - view.y;
+  if (i < 0 || j < 0 || i >= view.cols || j >= view.lines)
+    return false;
+  *x = view.left + i;
+  *y = view.top + j;
+  return true;
+}
+
+// Writes n chars of text starting at world cell (x, y), leaving out
+// whatever falls outside the window
+static void putspan(int x, int y, const char * text, int n) {
+  int j = y - view.y;
+  if (j < 0 || j >= view.lines)
+    return;
+  int i = x - view.x;
+  if (i < 0) {
+    text -= i;
+    n += i;
+    i = 0;
+  }
+  if (i + n > view.cols)
+    n = view.cols - i;
+  if (n > 0)
+    mvaddnstr(view.top + j, view.left + i, text, n);
+}
+
+// Sprites reach a little past their collision radius, since the
+// radius is rounded down and the sprite is drawn from the cell the
+// center is in
+static void findvisible(const SpatialHash & hash) {
+  hash.region(view.x - 2, view.y - 1, view.x + view.cols + 1, view.y + view.lines, &visible);
+}
+
+void printvisible(const BodyStore & bodies, const SpatialHash & hash) {
+  findvisible(hash);
+  for (size_t k = 0; k < visible.size(); ++k) {
+    int i = visible[k];
+    printcircle(bodies.getx(i), bodies.gety(i), bodies.getsize(i));
+  }
+}
+
+void erasevisible(const BodyStore & bodies, const SpatialHash & hash) {
+  findvisible(hash);
+  for (size_t k = 0; k < visible.size(); ++k) {
+    int i = visible[k];
+    erasecircle(bodies.getx(i), bodies.gety(i), bodies.getsize(i));
+  }
+}
+
+void printmarker(int cols, int lines, char mark, bool highlight) {
+  if (!toscreen(&cols, &lines))
+    return;
+  wmove(stdscr, lines, cols);
+  addch(highlight ? mark | A_STANDOUT : mark);
+}
+
+// Display the body, using ncurses.h functions
+void printbody(const Body & body) {
+  printcircle(body.getcellx(), body.getcelly(), body.getsize());
+}
+
+
+// Display a circle centered at (cols, lines), using ncurses.h functions
+void printcircle(int cols, int lines, int size) {
+  PROFILE_SCOPE(PROF_DRAW);
+  const Sprite & sprite = findsprite(size);
+  int x = cols - size;                // The input location is for the center of the circle. Find the top right corner for printing.
+  int y = lines - (size / 2);
+  for (int i = 0; i < sprite.nrows; ++i) {
+    const SpriteRow & row = sprite.rows[i];                   // Instead of spaces before the strings, move the cursor. That way, no
+    putspan(x + row.offset, y + i, row.text, row.width);      // old objects get overwritten.
+  }
+}
+
+
+// Prints over the selected Body with whitespace, using
+// ncurses functions
+void erasebody(const Body & body) {
+  erasecircle(body.getcellx(), body.getcelly(), body.getsize());
+}
+
+
+// Prints over a circle centered at (cols, lines) with whitespace
+void erasecircle(int cols, int lines, int size) {
+  PROFILE_SCOPE(PROF_DRAW);
+  const Sprite & sprite = findsprite(size);
+  const char * blank = spriteblank(size);   // Same spans as the sprite, so only its own chars are cleared
+  int x = cols - size;
+  int y = lines - (size / 2);
+  for (int i = 0; i < sprite.nrows; ++i) {
+    const SpriteRow & row = sprite.rows[i];
+    putspan(x + row.offset, y + i, blank, row.width);
+  }
+}
+
+
+// Prints a missile. Just a single char, so simpler than
+// above
+void printmissile(const Missile & missile) {
+  printmissileat(missile.getcellx(), missile.getcelly());
+}
+
+// Prints a single space over the missile location
+void erasemissile(const Missile & missile) {
+  erasemissileat(missile.getcellx(), missile.getcelly());
+}
+
+void printmissileat(int cols, int lines) {
+  PROFILE_SCOPE(PROF_DRAW);
+  char projectile = '+';
+  if (!toscreen(&cols, &lines))
+    return;
+  wmove(stdscr, lines, cols);
+  addch(projectile);
+}
+
+void erasemissileat(int cols, int lines) {
+  PROFILE_SCOPE(PROF_DRAW);
+  char erase = ' ';
+  if (!toscreen(&cols, &lines))
+    return;
+  wmove(stdscr,lines, cols);
+  addch(erase);
+}
+
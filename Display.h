@@ -0,0 +1,61 @@
+#ifndef DISPLAY_H
+#define DISPLAY_H
+
+// Drawing functions for the ncurses front end. The simulation
+// core knows nothing about the terminal; everything that touches
+// the screen lives here.
+
+class Body;
+class Missile;
+class BodyStore;
+class SpatialHash;
+struct Viewport;
+
+// Starts ncurses and notes where the output counters stand
+void startdisplay();
+
+// Starts ncurses on an lines by cols terminal whose output is thrown
+// away, so the draw path can be timed without a screen
+void startnulldisplay(int, int);
+
+// Sends everything drawn since the last frame to the terminal in
+// a single update
+void presentframe();
+
+// Frames presented, and bytes and write calls sent to the
+// terminal, since startdisplay()
+void displaystats(long *, long *, long *);
+
+// Every draw function below takes world cells. They are moved into
+// the viewport's window and clipped to it; until one is set, world
+// and screen cells are the same and nothing is clipped.
+void setviewport(const Viewport &);
+
+// Blanks the viewport's window, e.g. before redrawing it after the
+// camera moves
+void clearview();
+
+// Draw or erase the bodies that show in the viewport, found through
+// the collision index rather than by looking at every body
+void printvisible(const BodyStore &, const SpatialHash &);
+void erasevisible(const BodyStore &, const SpatialHash &);
+
+// A single char at world cell (x, y), e.g. a player's mark,
+// optionally highlighted
+void printmarker(int, int, char, bool);
+
+// Draw or erase a circle of the given size centered at (x, y)
+void printcircle(int, int, int);
+void erasecircle(int, int, int);
+
+// Draw or erase a body at its current screen cell
+void printbody(const Body &);
+void erasebody(const Body &);
+void printmissile(const Missile &);
+void erasemissile(const Missile &);
+
+// Same, for a missile in the given screen cell (x, y)
+void printmissileat(int, int);
+void erasemissileat(int, int);
+
+#endif
@@ -0,0 +1,146 @@
+#include<cmath>
+#include"FieldGrid.h"
+#include"Physics.h"
+
+FieldGrid::FieldGrid(int r) : isready(false), stop(false) {
+  this->res = r;
+  this->law = FORCE_NEWTON;
+  this->width = 0;
+  this->height = 0;
+}
+
+FieldGrid::~FieldGrid() {
+  this->cancel();
+}
+
+// A grid baked at the old resolution is no use at the new one, so it
+// is thrown away and has to be built again
+void FieldGrid::setresolution(int r) {
+  this->cancel();
+  this->isready = false;
+  this->accel.clear();
+  this->width = 0;
+  this->height = 0;
+  this->res = (r > 0 ? r : 1);
+}
+
+int FieldGrid::getresolution() const {
+  return this->res;
+}
+
+bool FieldGrid::ready() const {
+  return this->isready.load(std::memory_order_acquire);
+}
+
+// Stops a background build and waits for the thread to finish
+void FieldGrid::cancel() {
+  this->stop = true;
+  if (this->worker.joinable())
+    this->worker.join();
+  this->stop = false;
+}
+
+void FieldGrid::wait() {
+  if (this->worker.joinable())
+    this->worker.join();
+}
+
+void FieldGrid::build(const BodyStore & layout, int nlines, int ncols, int forcelaw) {
+  this->cancel();
+  this->isready = false;
+  this->bodies = layout;
+  this->law = forcelaw;
+  this->width = ncols * this->res + 1;
+  this->height = nlines * this->res + 1;
+  this->fill();
+}
+
+void FieldGrid::buildasync(const BodyStore & layout, int nlines, int ncols, int forcelaw) {
+  this->cancel();
+  this->isready = false;
+  this->bodies = layout;
+  this->law = forcelaw;
+  this->width = ncols * this->res + 1;
+  this->height = nlines * this->res + 1;
+  this->worker = std::thread(&FieldGrid::fill, this);
+}
+
+// Computes the acceleration at every sample. Inside a body's
+// collision radius the pull of that body is held at its value on
+// the surface, so the samples near a planet's center stay finite
+// and the interpolation just outside the planet stays smooth.
+// A missile never gets that far in without colliding.
+void FieldGrid::fill() {
+  switch (this->law) {
+    case FORCE_SOFTENED:
+      this->fillwith<SoftenedLaw>();
+      break;
+    case FORCE_INVERSE:
+      this->fillwith<InverseLinearLaw>();
+      break;
+    default:
+      this->fillwith<NewtonLaw>();
+      break;
+  }
+}
+
+template <class Law>
+void FieldGrid::fillwith() {
+  std::vector<float> grid(2 * (size_t)this->width * this->height);
+  const double * bx = this->bodies.xdata();
+  const double * by = this->bodies.ydata();
+  const double * bm = this->bodies.massdata();
+  const double * brad = this->bodies.raddata();
+  int n = this->bodies.count();
+  double step = 1.0 / this->res;
+
+  for (int j = 0; j < this->height; ++j) {
+    if (this->stop)
+      return;
+    double py = j * step;
+    for (int i = 0; i < this->width; ++i) {
+      double px = i * step;
+      double ax = 0;
+      double ay = 0;
+      for (int b = 0; b < n; ++b) {
+        double dx = (bx[b] - px) * (1 / ASPECT);   // distance units in the x-direction are shorter
+        double dy = by[b] - py;
+        double r2 = dx * dx + dy * dy;
+        if (r2 == 0)
+          continue;
+        double r = sqrt(r2);
+        double rc = fmax(r, brad[b]);       // Clamp at the surface
+        double w = pullweight<Law>(bm[b], rc * rc) * (rc / r);
+        ax += w * dx;
+        ay += w * dy;
+      }
+      size_t k = 2 * ((size_t)j * this->width + i);
+      grid[k] = ax;
+      grid[k + 1] = ay;
+    }
+  }
+
+  this->accel.swap(grid);
+  this->isready.store(true, std::memory_order_release);
+}
+
+void FieldGrid::getforce(double px, double py, double m, double * force) const {
+  double gx = px * this->res;
+  double gy = py * this->res;
+
+  // Clamp to the grid; missiles outside it are about to leave the screen
+  int i = floor(gx);
+  int j = floor(gy);
+  i = (i < 0 ? 0 : (i > this->width - 2 ? this->width - 2 : i));
+  j = (j < 0 ? 0 : (j > this->height - 2 ? this->height - 2 : j));
+  double fx = fmin(fmax(gx - i, 0.0), 1.0);
+  double fy = fmin(fmax(gy - j, 0.0), 1.0);
+
+  const float * a = &this->accel[2 * ((size_t)j * this->width + i)];   // Top left sample
+  const float * b = a + 2 * this->width;                               // Bottom left sample
+
+  double ax = (1 - fy) * ((1 - fx) * a[0] + fx * a[2]) + fy * ((1 - fx) * b[0] + fx * b[2]);
+  double ay = (1 - fy) * ((1 - fx) * a[1] + fx * a[3]) + fy * ((1 - fx) * b[1] + fx * b[3]);
+  force[0] = m * ax;
+  force[1] = m * ay;
+}
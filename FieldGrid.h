@@ -0,0 +1,59 @@
+#ifndef FIELDGRID_H
+#define FIELDGRID_H
+
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "BodyStore.h"
+
+// Gravity of a fixed layout baked into a grid of acceleration
+// vectors. Planets never move after arrangeplanets, so the field is
+// computed once and each step is a bilinear lookup instead of a sum
+// over every body. The grid can be built in a background thread;
+// until it is ready the caller falls back to the exact sum.
+class FieldGrid {
+
+
+  public:
+
+    FieldGrid(int = 2);
+    ~FieldGrid();
+
+    // Samples per screen cell in each direction. Changing it cancels
+    // any build and drops the grid until the next one.
+    void setresolution(int);
+    int getresolution() const;
+
+    // Build the grid for a layout of nlines by ncols under a
+    // ForceLawKind, either right away or in the background. Starting
+    // a new build cancels any build still in progress.
+    void build(const BodyStore &, int, int, int);
+    void buildasync(const BodyStore &, int, int, int);
+    void cancel();
+    void wait();                 // Until a background build is done
+
+    bool ready() const;
+
+    // Same contract as sumforce() in Gravity.h. Only valid once ready().
+    void getforce(double, double, double, double *) const;
+
+
+  protected:
+
+    void fill();
+    template <class Law> void fillwith();
+
+    BodyStore bodies;            // Private copy, so the layout can change during a build
+    std::vector<float> accel;    // (ax, ay) pairs, row by row
+    int res;
+    int law;                     // Force law the grid is baked for
+    int width;                   // Number of samples across
+    int height;                  // Number of samples down
+
+    std::thread worker;
+    std::atomic<bool> isready;
+    std::atomic<bool> stop;
+
+};
+
+#endif
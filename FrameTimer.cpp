@@ -0,0 +1,86 @@
+#include<cmath>
+#include<thread>
+#include"FrameTimer.h"
+#include"Profile.h"
+
+using namespace std::chrono;
+
+// Longest step or frame the timer takes. The clock counts in
+// nanoseconds, so anything far past this can't be held, and NaN or
+// infinity can't be converted at all.
+static const double MAXINTERVAL = 3600;
+
+// Seconds to clock ticks, clamped to [0, MAXINTERVAL] first
+static steady_clock::duration interval(double secs) {
+  if (!(secs > 0))
+    secs = 0;                                 // Also NaN
+  if (secs > MAXINTERVAL)
+    secs = MAXINTERVAL;
+  return duration_cast<steady_clock::duration>(duration<double>(secs));
+}
+
+FrameTimer::FrameTimer(double stepsecs, double fps) {
+  this->maxspeed = false;
+  this->setstep(stepsecs);
+  this->setmaxfps(fps);
+  this->start();
+}
+
+void FrameTimer::setstep(double secs) {
+  this->step = interval(secs);
+  if (!(this->step > Clock::duration::zero()))
+    this->step = Clock::duration(1);         // A zero step would make every step due at once
+}
+
+void FrameTimer::setmaxfps(double fps) {
+  this->frame = interval(fps > 0 ? 1 / fps : 0);
+}
+
+void FrameTimer::setmaxspeed(bool on) {
+  this->maxspeed = on;
+}
+
+bool FrameTimer::getmaxspeed() const {
+  return this->maxspeed;
+}
+
+void FrameTimer::start() {
+  this->nextstep = Clock::now() + this->step;    // The first step happens one step in
+  this->nextframe = Clock::now();
+}
+
+int FrameTimer::stepsdue() {
+  if (this->maxspeed)
+    return 1;
+
+  // Steps are counted off a fixed schedule, so a slow frame is made
+  // up with extra steps rather than slowing the missile down
+  Clock::time_point now = Clock::now();
+  if (this->nextstep > now)
+    return 0;
+  long long due = (now - this->nextstep) / this->step + 1;
+  if (due > MAXDUE) {
+    this->nextstep = now + this->step;       // Too far behind to catch up; go on at the normal pace
+    return MAXDUE;
+  }
+  this->nextstep += due * this->step;
+  return due;
+}
+
+bool FrameTimer::renderdue() {
+  if (this->maxspeed)
+    return false;
+  Clock::time_point now = Clock::now();
+  if (now < this->nextframe)
+    return false;
+  this->nextframe = now + this->frame;
+  return true;
+}
+
+void FrameTimer::sleep() const {
+  PROFILE_SCOPE(PROF_WAIT);
+  // Frames only change when the physics steps, so the next step is
+  // the next time there's anything to do
+  if (!this->maxspeed)
+    std::this_thread::sleep_until(this->nextstep);
+}
@@ -0,0 +1,51 @@
+#ifndef FRAMETIMER_H
+#define FRAMETIMER_H
+
+#include <chrono>
+
+// Paces an animation off the monotonic clock. Physics advances in
+// fixed steps of "step" seconds of wall time, however long drawing
+// takes; rendering is capped at its own rate and only happens when
+// a frame is due. Between the two the thread sleeps instead of
+// spinning. In max speed mode nothing waits and nothing renders.
+class FrameTimer {
+
+
+  public:
+
+    FrameTimer(double = 0.1, double = 30);
+
+    void setstep(double);        // Seconds of wall time per physics step, from one clock tick to an hour
+    void setmaxfps(double);      // Cap on rendered frames per second
+    void setmaxspeed(bool);
+    bool getmaxspeed() const;
+
+    void start();
+
+    // Physics steps whose time has come since the last call, at most
+    // MAXDUE. A schedule further behind than that is dropped and
+    // starts again from now.
+    int stepsdue();
+
+    static const int MAXDUE = 1000;
+
+    // True if enough time has passed since the last rendered frame
+    bool renderdue();
+
+    // Sleeps until the next physics step is due
+    void sleep() const;
+
+
+  protected:
+
+    typedef std::chrono::steady_clock Clock;
+
+    Clock::duration step;
+    Clock::duration frame;
+    Clock::time_point nextstep;
+    Clock::time_point nextframe;
+    bool maxspeed;
+
+};
+
+#endif
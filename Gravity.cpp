@@ -0,0 +1,272 @@
+#include<cmath>
+#include"Gravity.h"
+#include"BodyStore.h"
+#include"Physics.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include<immintrin.h>
+#define GRAVITY_X86
+#endif
+
+// All kernels compute, for every body i,
+//   dx = (x_i - px) / ASPECT,  dy = y_i - py,  r2 = dx^2 + dy^2
+//   F += m * pullweight(m_i, r2) * (dx, dy)
+// Distance units in the x-direction are shorter, hence the scaled
+// dx. Bodies at the same location as the input add no force. Each
+// kernel returns the sum of pullweight(m_i, r2) * (dx, dy) and the
+// caller scales by m. Every kernel is a template on the force law
+// (Physics.h), instantiated once per law.
+
+typedef void (*forcekernel)(const double *, const double *, const double *, int,
+                            double, double, double *, double *);
+
+// The batch kernels run the same sum for n points, bodies in the
+// outer loop and points across the SIMD lanes
+typedef void (*batchkernel)(const double *, const double *, const double *, int,
+                            const double *, const double *, int, double *, double *);
+
+template <class Law>
+static void kernel_scalar(const double * bx, const double * by, const double * bm, int n,
+                          double px, double py, double * outx, double * outy) {
+  double ax = 0;
+  double ay = 0;
+  for (int i = 0; i < n; ++i) {
+    double dx = (bx[i] - px) * (1 / ASPECT);
+    double dy = by[i] - py;
+    double r2 = dx * dx + dy * dy;
+    if (r2 == 0)
+      continue;
+    double w = pullweight<Law>(bm[i], r2);
+    ax += w * dx;
+    ay += w * dy;
+  }
+  *outx = ax;
+  *outy = ay;
+}
+
+template <class Law>
+static void batch_scalar(const double * bx, const double * by, const double * bm, int n,
+                         const double * px, const double * py, int npoints, double * ax, double * ay) {
+  for (int k = 0; k < npoints; ++k)
+    kernel_scalar<Law>(bx, by, bm, n, px[k], py[k], ax + k, ay + k);
+}
+
+#ifdef GRAVITY_X86
+
+// pullweight for a vector of bodies
+template <class Law>
+__attribute__((target("sse2")))
+static inline __m128d pullweight_sse2(__m128d m, __m128d r2) {
+  __m128d s2 = (Law::SOFTENING2 != 0 ? _mm_add_pd(r2, _mm_set1_pd(Law::SOFTENING2)) : r2);
+  __m128d d = (Law::POWER == 3 ? _mm_mul_pd(s2, _mm_sqrt_pd(s2)) : s2);
+  return _mm_div_pd(Law::G != 1 ? _mm_mul_pd(m, _mm_set1_pd(Law::G)) : m, d);
+}
+
+template <class Law>
+__attribute__((target("avx2")))
+static inline __m256d pullweight_avx2(__m256d m, __m256d r2) {
+  __m256d s2 = (Law::SOFTENING2 != 0 ? _mm256_add_pd(r2, _mm256_set1_pd(Law::SOFTENING2)) : r2);
+  __m256d d = (Law::POWER == 3 ? _mm256_mul_pd(s2, _mm256_sqrt_pd(s2)) : s2);
+  return _mm256_div_pd(Law::G != 1 ? _mm256_mul_pd(m, _mm256_set1_pd(Law::G)) : m, d);
+}
+
+template <class Law>
+__attribute__((target("sse2")))
+static void kernel_sse2(const double * bx, const double * by, const double * bm, int n,
+                        double px, double py, double * outx, double * outy) {
+  __m128d vpx = _mm_set1_pd(px);
+  __m128d vpy = _mm_set1_pd(py);
+  __m128d half = _mm_set1_pd(1 / ASPECT);
+  __m128d zero = _mm_setzero_pd();
+  __m128d ax = zero;
+  __m128d ay = zero;
+
+  int i = 0;
+  for (; i + 2 <= n; i += 2) {
+    __m128d dx = _mm_mul_pd(_mm_sub_pd(_mm_loadu_pd(bx + i), vpx), half);
+    __m128d dy = _mm_sub_pd(_mm_loadu_pd(by + i), vpy);
+    __m128d r2 = _mm_add_pd(_mm_mul_pd(dx, dx), _mm_mul_pd(dy, dy));
+    __m128d w = pullweight_sse2<Law>(_mm_loadu_pd(bm + i), r2);
+    w = _mm_and_pd(w, _mm_cmpneq_pd(r2, zero));   // Drop bodies at the same location
+    ax = _mm_add_pd(ax, _mm_mul_pd(w, dx));
+    ay = _mm_add_pd(ay, _mm_mul_pd(w, dy));
+  }
+
+  double lx[2], ly[2];
+  _mm_storeu_pd(lx, ax);
+  _mm_storeu_pd(ly, ay);
+  double tx, ty;
+  kernel_scalar<Law>(bx + i, by + i, bm + i, n - i, px, py, &tx, &ty);   // Leftover body
+  *outx = lx[0] + lx[1] + tx;
+  *outy = ly[0] + ly[1] + ty;
+}
+
+template <class Law>
+__attribute__((target("avx2")))
+static void kernel_avx2(const double * bx, const double * by, const double * bm, int n,
+                        double px, double py, double * outx, double * outy) {
+  __m256d vpx = _mm256_set1_pd(px);
+  __m256d vpy = _mm256_set1_pd(py);
+  __m256d half = _mm256_set1_pd(1 / ASPECT);
+  __m256d zero = _mm256_setzero_pd();
+  __m256d ax = zero;
+  __m256d ay = zero;
+
+  int i = 0;
+  for (; i + 4 <= n; i += 4) {
+    __m256d dx = _mm256_mul_pd(_mm256_sub_pd(_mm256_loadu_pd(bx + i), vpx), half);
+    __m256d dy = _mm256_sub_pd(_mm256_loadu_pd(by + i), vpy);
+    __m256d r2 = _mm256_add_pd(_mm256_mul_pd(dx, dx), _mm256_mul_pd(dy, dy));
+    __m256d w = pullweight_avx2<Law>(_mm256_loadu_pd(bm + i), r2);
+    w = _mm256_and_pd(w, _mm256_cmp_pd(r2, zero, _CMP_NEQ_OQ));   // Drop bodies at the same location
+    ax = _mm256_add_pd(ax, _mm256_mul_pd(w, dx));
+    ay = _mm256_add_pd(ay, _mm256_mul_pd(w, dy));
+  }
+
+  double lx[4], ly[4];
+  _mm256_storeu_pd(lx, ax);
+  _mm256_storeu_pd(ly, ay);
+  double tx, ty;
+  _mm256_zeroupper();   // The tail is SSE code, and GCC doesn't always do this for it
+  kernel_scalar<Law>(bx + i, by + i, bm + i, n - i, px, py, &tx, &ty);   // Up to three leftover bodies
+  *outx = (lx[0] + lx[1]) + (lx[2] + lx[3]) + tx;
+  *outy = (ly[0] + ly[1]) + (ly[2] + ly[3]) + ty;
+}
+
+// Four points at a time; each body's position and mass is broadcast
+// to all four lanes
+template <class Law>
+__attribute__((target("avx2")))
+static void batch_avx2(const double * bx, const double * by, const double * bm, int n,
+                       const double * px, const double * py, int npoints, double * ax, double * ay) {
+  __m256d half = _mm256_set1_pd(1 / ASPECT);
+  __m256d zero = _mm256_setzero_pd();
+  int k = 0;
+  for (; k + 4 <= npoints; k += 4) {
+    __m256d vpx = _mm256_loadu_pd(px + k);
+    __m256d vpy = _mm256_loadu_pd(py + k);
+    __m256d sx = zero;
+    __m256d sy = zero;
+    for (int i = 0; i < n; ++i) {
+      __m256d dx = _mm256_mul_pd(_mm256_sub_pd(_mm256_set1_pd(bx[i]), vpx), half);
+      __m256d dy = _mm256_sub_pd(_mm256_set1_pd(by[i]), vpy);
+      __m256d r2 = _mm256_add_pd(_mm256_mul_pd(dx, dx), _mm256_mul_pd(dy, dy));
+      __m256d w = pullweight_avx2<Law>(_mm256_set1_pd(bm[i]), r2);
+      w = _mm256_and_pd(w, _mm256_cmp_pd(r2, zero, _CMP_NEQ_OQ));
+      sx = _mm256_add_pd(sx, _mm256_mul_pd(w, dx));
+      sy = _mm256_add_pd(sy, _mm256_mul_pd(w, dy));
+    }
+    _mm256_storeu_pd(ax + k, sx);
+    _mm256_storeu_pd(ay + k, sy);
+  }
+  _mm256_zeroupper();
+  batch_scalar<Law>(bx, by, bm, n, px + k, py + k, npoints - k, ax + k, ay + k);
+}
+
+template <class Law>
+__attribute__((target("sse2")))
+static void batch_sse2(const double * bx, const double * by, const double * bm, int n,
+                       const double * px, const double * py, int npoints, double * ax, double * ay) {
+  __m128d half = _mm_set1_pd(1 / ASPECT);
+  __m128d zero = _mm_setzero_pd();
+  int k = 0;
+  for (; k + 2 <= npoints; k += 2) {
+    __m128d vpx = _mm_loadu_pd(px + k);
+    __m128d vpy = _mm_loadu_pd(py + k);
+    __m128d sx = zero;
+    __m128d sy = zero;
+    for (int i = 0; i < n; ++i) {
+      __m128d dx = _mm_mul_pd(_mm_sub_pd(_mm_set1_pd(bx[i]), vpx), half);
+      __m128d dy = _mm_sub_pd(_mm_set1_pd(by[i]), vpy);
+      __m128d r2 = _mm_add_pd(_mm_mul_pd(dx, dx), _mm_mul_pd(dy, dy));
+      __m128d w = pullweight_sse2<Law>(_mm_set1_pd(bm[i]), r2);
+      w = _mm_and_pd(w, _mm_cmpneq_pd(r2, zero));
+      sx = _mm_add_pd(sx, _mm_mul_pd(w, dx));
+      sy = _mm_add_pd(sy, _mm_mul_pd(w, dy));
+    }
+    _mm_storeu_pd(ax + k, sx);
+    _mm_storeu_pd(ay + k, sy);
+  }
+  batch_scalar<Law>(bx, by, bm, n, px + k, py + k, npoints - k, ax + k, ay + k);
+}
+
+#endif
+
+// One of each kernel per law, indexed by ForceLawKind, so the law is
+// settled by which kernel is called rather than inside it
+struct KernelSet {
+  const char * name;
+  forcekernel force[FORCELAWS];
+  batchkernel batch[FORCELAWS];
+};
+
+template <class Law>
+static void setlaw(KernelSet & k, int law, int width) {
+  k.force[law] = kernel_scalar<Law>;
+  k.batch[law] = batch_scalar<Law>;
+#ifdef GRAVITY_X86
+  if (width == 2) {
+    k.force[law] = kernel_sse2<Law>;
+    k.batch[law] = batch_sse2<Law>;
+  }
+  else if (width == 4) {
+    k.force[law] = kernel_avx2<Law>;
+    k.batch[law] = batch_avx2<Law>;
+  }
+#endif
+}
+
+// Chooses the kernels based on what the CPU supports
+static KernelSet pickkernels() {
+  KernelSet k;
+  int width = 1;
+  k.name = "scalar";
+#ifdef GRAVITY_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) {
+    width = 4;
+    k.name = "avx2";
+  }
+  else if (__builtin_cpu_supports("sse2")) {
+    width = 2;
+    k.name = "sse2";
+  }
+#endif
+  setlaw<NewtonLaw>(k, FORCE_NEWTON, width);
+  setlaw<SoftenedLaw>(k, FORCE_SOFTENED, width);
+  setlaw<InverseLinearLaw>(k, FORCE_INVERSE, width);
+  return k;
+}
+
+// Picked on the first call rather than during static initialization,
+// so a static initializer elsewhere that sums forces still finds them
+static const KernelSet & activekernels() {
+  static const KernelSet k = pickkernels();
+  return k;
+}
+
+static const forcekernel scalarkernel[FORCELAWS] = {
+  kernel_scalar<NewtonLaw>, kernel_scalar<SoftenedLaw>, kernel_scalar<InverseLinearLaw>
+};
+
+void sumforce(const BodyStore & bodies, double px, double py, double m, double * force, int law) {
+  double ax, ay;
+  activekernels().force[law](bodies.xdata(), bodies.ydata(), bodies.massdata(), bodies.count(), px, py, &ax, &ay);
+  force[0] = m * ax;
+  force[1] = m * ay;
+}
+
+void sumforce_scalar(const BodyStore & bodies, double px, double py, double m, double * force, int law) {
+  double ax, ay;
+  scalarkernel[law](bodies.xdata(), bodies.ydata(), bodies.massdata(), bodies.count(), px, py, &ax, &ay);
+  force[0] = m * ax;
+  force[1] = m * ay;
+}
+
+void sumaccelbatch(const BodyStore & bodies, const double * px, const double * py, int n, double * ax, double * ay, int law) {
+  activekernels().batch[law](bodies.xdata(), bodies.ydata(), bodies.massdata(), bodies.count(), px, py, n, ax, ay);
+}
+
+const char * gravitykernel() {
+  return activekernels().name;
+}
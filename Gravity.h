@@ -0,0 +1,27 @@
+#ifndef GRAVITY_H
+#define GRAVITY_H
+
+class BodyStore;
+
+// Sums the gravitational force on a body of mass m at (px, py)
+// from every body in the store, under the given ForceLawKind
+// (Physics.h). The result is written to force[0] (x) and force[1]
+// (y). Uses the widest SIMD kernel the CPU supports, chosen on the
+// first call.
+void sumforce(const BodyStore &, double, double, double, double *, int);
+
+// Plain C++ version of the kernel. Gives the same results as the
+// SIMD versions, up to floating point rounding.
+void sumforce_scalar(const BodyStore &, double, double, double, double *, int);
+
+// Batched version for many points at once, such as a salvo of
+// missiles: for each of the n points (px[k], py[k]) writes the sum of
+// pullweight(m_i, r2) * (dx, dy) over the bodies, i.e. the force per
+// unit mass, to (ax[k], ay[k]). Vectorised across the points rather
+// than the bodies, with the same kernel choice as sumforce.
+void sumaccelbatch(const BodyStore &, const double *, const double *, int, double *, double *, int);
+
+// Name of the kernel sumforce is using ("avx2", "sse2" or "scalar")
+const char * gravitykernel();
+
+#endif
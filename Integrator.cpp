@@ -0,0 +1,202 @@
+#include<cmath>
+#include<cstring>
+#include"Integrator.h"
+#include"Sim.h"
+#include"Gravity.h"
+#include"Physics.h"
+#include"Profile.h"
+
+MotionState motionstate(double x, double y, double vx, double vy) {
+  MotionState s;
+  s.x = x;
+  s.y = y;
+  s.vx = vx;
+  s.vy = vy;
+  s.ax = 0;
+  s.ay = 0;
+  s.haveaccel = false;
+  s.h = 1;
+  s.evals = 0;
+  return s;
+}
+
+int forcesource(const Layout & layout) {
+  if (layout.grid.ready())
+    return SOURCE_GRID;
+  if (layout.planets.count() > BH_THRESHOLD)
+    return SOURCE_TREE;
+  return SOURCE_SUM;
+}
+
+void fieldaccel(const Layout & layout, int source, double x, double y, double * a) {
+  PROFILE_SCOPE(PROF_FORCE);
+  if (source == SOURCE_GRID)
+    layout.grid.getforce(x, y, 1, a);
+  else if (source == SOURCE_TREE)
+    layout.tree.getforce(x, y, 1, a, layout.forcelaw);
+  else
+    sumforce(layout.planets, x, y, 1, a, layout.forcelaw);
+}
+
+namespace {
+
+void accelat(const Layout & layout, int source, MotionState & s, double x, double y, double * a) {
+  fieldaccel(layout, source, x, y, a);
+  ++s.evals;
+}
+
+void euler(const Layout & layout, int source, MotionState & s) {
+  double a[2];
+  accelat(layout, source, s, s.x, s.y, a);
+  s.vx += a[0];
+  s.vy += a[1];
+  s.x += s.vx;
+  s.y += s.vy / ASPECT;
+  s.haveaccel = false;
+}
+
+// Kick-drift-kick form; the acceleration at the end of one frame is
+// reused at the start of the next
+void verlet(const Layout & layout, int source, MotionState & s) {
+  double a[2];
+  if (!s.haveaccel) {
+    accelat(layout, source, s, s.x, s.y, a);
+    s.ax = a[0];
+    s.ay = a[1];
+  }
+  s.vx += s.ax / 2;
+  s.vy += s.ay / 2;
+  s.x += s.vx;
+  s.y += s.vy / ASPECT;
+  accelat(layout, source, s, s.x, s.y, a);
+  s.ax = a[0];
+  s.ay = a[1];
+  s.vx += s.ax / 2;
+  s.vy += s.ay / 2;
+  s.haveaccel = true;
+}
+
+// Dormand-Prince tableau
+const double c2 = 1.0 / 5, c3 = 3.0 / 10, c4 = 4.0 / 5, c5 = 8.0 / 9;
+const double a21 = 1.0 / 5;
+const double a31 = 3.0 / 40, a32 = 9.0 / 40;
+const double a41 = 44.0 / 45, a42 = -56.0 / 15, a43 = 32.0 / 9;
+const double a51 = 19372.0 / 6561, a52 = -25360.0 / 2187, a53 = 64448.0 / 6561, a54 = -212.0 / 729;
+const double a61 = 9017.0 / 3168, a62 = -355.0 / 33, a63 = 46732.0 / 5247, a64 = 49.0 / 176, a65 = -5103.0 / 18656;
+const double b1 = 35.0 / 384, b3 = 500.0 / 1113, b4 = 125.0 / 192, b5 = -2187.0 / 6784, b6 = 11.0 / 84;
+const double e1 = 71.0 / 57600, e3 = -71.0 / 16695, e4 = 71.0 / 1920, e5 = -17253.0 / 339200,
+             e6 = 22.0 / 525, e7 = -1.0 / 40;     // Difference between the 5th and 4th order weights
+
+const double MINSTEP = 1e-4;   // Below this a step is taken whatever its error
+
+// Derivative of (x, y, vx, vy)
+void deriv(const Layout & layout, int source, MotionState & s, const double * u, double * k) {
+  double a[2];
+  accelat(layout, source, s, u[0], u[1], a);
+  k[0] = u[2];
+  k[1] = u[3] / ASPECT;
+  k[2] = a[0];
+  k[3] = a[1];
+}
+
+void rk45(const Layout & layout, int source, double tol, MotionState & s) {
+  double u[4] = {s.x, s.y, s.vx, s.vy};
+  double k1[4], k2[4], k3[4], k4[4], k5[4], k6[4], k7[4], t[4], next[4];
+
+  // The first stage is the acceleration at the current point, which
+  // the last accepted step already worked out
+  if (s.haveaccel) {
+    k1[0] = u[2]; k1[1] = u[3] / ASPECT; k1[2] = s.ax; k1[3] = s.ay;
+  }
+  else {
+    deriv(layout, source, s, u, k1);
+  }
+
+  double done = 0;
+  double h = fmax(s.h, MINSTEP);
+  while (done < 1 - 1e-12) {
+    double step = fmin(h, 1 - done);    // Land exactly on the frame boundary
+
+    for (int i = 0; i < 4; ++i) t[i] = u[i] + step * a21 * k1[i];
+    deriv(layout, source, s, t, k2);
+    for (int i = 0; i < 4; ++i) t[i] = u[i] + step * (a31 * k1[i] + a32 * k2[i]);
+    deriv(layout, source, s, t, k3);
+    for (int i = 0; i < 4; ++i) t[i] = u[i] + step * (a41 * k1[i] + a42 * k2[i] + a43 * k3[i]);
+    deriv(layout, source, s, t, k4);
+    for (int i = 0; i < 4; ++i) t[i] = u[i] + step * (a51 * k1[i] + a52 * k2[i] + a53 * k3[i] + a54 * k4[i]);
+    deriv(layout, source, s, t, k5);
+    for (int i = 0; i < 4; ++i) t[i] = u[i] + step * (a61 * k1[i] + a62 * k2[i] + a63 * k3[i] + a64 * k4[i] + a65 * k5[i]);
+    deriv(layout, source, s, t, k6);
+    for (int i = 0; i < 4; ++i) next[i] = u[i] + step * (b1 * k1[i] + b3 * k3[i] + b4 * k4[i] + b5 * k5[i] + b6 * k6[i]);
+    deriv(layout, source, s, next, k7);
+
+    // Scaled error of the step; 1 means exactly at tolerance
+    double err = 0;
+    for (int i = 0; i < 4; ++i) {
+      double e = step * (e1 * k1[i] + e3 * k3[i] + e4 * k4[i] + e5 * k5[i] + e6 * k6[i] + e7 * k7[i]);
+      double scale = tol * (1 + fmax(fabs(u[i]), fabs(next[i])));
+      err = fmax(err, fabs(e) / scale);
+    }
+    double grow = (err > 0 ? fmin(fmax(0.9 * pow(err, -0.2), 0.2), 5) : 5);
+
+    bool accept = (err <= 1 || step <= MINSTEP);
+    if (accept) {
+      for (int i = 0; i < 4; ++i) {
+        u[i] = next[i];
+        k1[i] = k7[i];      // First same as last
+      }
+      done += step;
+    }
+
+    // A step cut short by the frame boundary says nothing about how
+    // big the next one can be, so only let it grow h
+    double proposed = step * grow;
+    if (accept && step < h)
+      proposed = fmax(proposed, h);
+    h = fmax(proposed, MINSTEP);
+  }
+  s.h = h;
+
+  s.x = u[0];
+  s.y = u[1];
+  s.vx = u[2];
+  s.vy = u[3];
+  s.ax = k1[2];
+  s.ay = k1[3];
+  s.haveaccel = true;
+}
+
+}
+
+void integrateframe(const Layout & layout, int source, int kind, double tol, MotionState & s) {
+  switch (kind) {
+    case INTEGRATE_VERLET:
+      verlet(layout, source, s);
+      break;
+    case INTEGRATE_RK45:
+      rk45(layout, source, tol, s);
+      break;
+    default:
+      euler(layout, source, s);
+      break;
+  }
+}
+
+int parseintegrator(const char * name) {
+  for (int k = INTEGRATE_EULER; k <= INTEGRATE_RK45; ++k) {
+    if (!strcmp(name, integratorname(k)))
+      return k;
+  }
+  return -1;
+}
+
+const char * integratorname(int kind) {
+  switch (kind) {
+    case INTEGRATE_VERLET:
+      return "verlet";
+    case INTEGRATE_RK45:
+      return "rk45";
+    default:
+      return "euler";
+  }
+}
@@ -0,0 +1,52 @@
+#ifndef INTEGRATOR_H
+#define INTEGRATOR_H
+
+struct Layout;
+
+// Ways to advance a missile through one frame
+enum IntegratorKind {
+  INTEGRATE_EULER,    // One force evaluation per frame, first order. How the game has always moved.
+  INTEGRATE_VERLET,   // Velocity Verlet (leapfrog). Still one evaluation per frame, second order.
+  INTEGRATE_RK45      // Dormand-Prince 5(4) with adaptive sub-steps to meet a tolerance
+};
+
+// A missile's state as the integrators see it. The equations of
+// motion are dx/dt = vx, dy/dt = vy / ASPECT (a char is twice as tall
+// as it is wide), and dv/dt = the field's acceleration.
+struct MotionState {
+  double x, y;
+  double vx, vy;
+  double ax, ay;      // Acceleration at (x, y), if haveaccel
+  bool haveaccel;
+  double h;           // RK45 sub-step carried over to the next frame
+  long evals;         // Force evaluations so far
+};
+
+// Where a missile's force comes from. A shot picks one when it is
+// fired and keeps it, so a grid that finishes baking mid-flight
+// doesn't change the rules partway along the path.
+enum ForceSource {
+  SOURCE_SUM,         // Exact sum over every body
+  SOURCE_TREE,        // Barnes-Hut tree
+  SOURCE_GRID         // Baked field grid
+};
+
+// The source a shot fired now should use: the grid if it is ready,
+// else the tree for large fields, else the exact sum
+int forcesource(const Layout &);
+
+// Starts a state at rest with nothing cached
+MotionState motionstate(double, double, double, double);
+
+// Advances the state by one frame, taking the force from a
+// ForceSource. tol is the RK45 error tolerance per frame.
+void integrateframe(const Layout &, int, int, double, MotionState &);
+
+// Acceleration of a missile at (x, y)
+void fieldaccel(const Layout &, int, double, double, double *);
+
+// "euler", "verlet" or "rk45" to an IntegratorKind, -1 if unknown
+int parseintegrator(const char *);
+const char * integratorname(int);
+
+#endif
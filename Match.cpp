@@ -0,0 +1,103 @@
+#include<cstring>
+#include"Match.h"
+
+MatchState startmatch(const ReplayHeader & h) {
+  MatchState state;
+  memset(&state, 0, sizeof(state));
+  state.seed = h.seed;
+  return state;
+}
+
+// Makes sure the layout is the one the state is on. False if the
+// field has no room for the players' planets.
+static bool uselayout(const MatchState & state, const ReplayHeader & h, Layout & layout) {
+  if (layout.generation > 0 && layout.seed == state.seed && layout.nlines == h.nlines && layout.ncols == h.ncols)
+    return layout.planets.count() >= 2;
+  if (arrangeplanets(layout, planetcount(h.nlines, h.ncols), h.nlines, h.ncols, state.seed).placed < 2)
+    return false;
+  if (h.gridres > 0)
+    layout.grid.build(layout.planets, h.nlines, h.ncols, h.forcelaw);
+  return true;
+}
+
+bool fieldplayable(const ReplayHeader & h) {
+  Layout layout;
+  return arrangeplanets(layout, planetcount(h.nlines, h.ncols), h.nlines, h.ncols, h.seed).placed >= 2;
+}
+
+TurnResult playturn(MatchState & state, const ReplayHeader & h, Layout & layout, Salvo & salvo, int action, double speed, double angle) {
+  TurnResult result;
+  memset(&result, 0, sizeof(result));         // No stray padding bytes on the wire
+  result.action = action;
+  result.player = state.player;
+  result.hit = -1;
+  result.speed = speed;
+  result.angle = angle;
+
+  int target = (state.player ? 0 : 1);
+  if (state.over) {
+    result.action = REPLAY_QUIT;
+  }
+  else if (action == REPLAY_QUIT) {
+    state.over = true;
+  }
+  else if (action == REPLAY_NEW) {
+    ++state.seed;
+  }
+  else if (action == REPLAY_FIRE && !uselayout(state, h, layout)) {
+    result.action = REPLAY_QUIT;              // Nowhere to fire from, so the game can't go on
+    state.over = true;
+  }
+  else if (action == REPLAY_FIRE && h.salvo > 1) {
+    salvo.clear();
+    salvo.firespread(h.salvo, speed, angle, h.spread, state.player);
+    int maxsteps = shotsteps(h);
+    for (int s = 0; s < maxsteps && salvo.step() > 0; ++s)
+      ;
+    salvo.stop();
+    for (int i = 0; i < salvo.count(); ++i)
+      result.hits += (salvo.gethit(salvo.missile(i)) == target);
+    result.hit = (result.hits > 0 ? target : -1);
+  }
+  else if (action == REPLAY_FIRE) {
+    ShotResult shot = simulate_shot(layout, speed, angle, state.player, shotsteps(h));
+    result.hit = shot.hit;
+    result.hits = (shot.hit == target);
+  }
+
+  if (result.action == REPLAY_FIRE) {
+    if (result.hits > 0)
+      ++state.score[state.player];
+    state.player = !state.player;
+    ++state.shots;
+  }
+  result.score[0] = state.score[0];
+  result.score[1] = state.score[1];
+  return result;
+}
+
+Match::Match(const ReplayHeader & h) : salvo(layout) {
+  this->header = h;
+  replaysettings(h, this->layout);
+  this->state = startmatch(h);
+}
+
+TurnResult Match::play(int action, double speed, double angle) {
+  return playturn(this->state, this->header, this->layout, this->salvo, action, speed, angle);
+}
+
+int Match::getplayer() const {
+  return this->state.player;
+}
+
+int Match::getshots() const {
+  return this->state.shots;
+}
+
+const int * Match::getscore() const {
+  return this->state.score;
+}
+
+bool Match::isover() const {
+  return this->state.over;
+}
@@ -0,0 +1,81 @@
+#ifndef MATCH_H
+#define MATCH_H
+
+#include <stdint.h>
+#include "Sim.h"
+#include "Salvo.h"
+#include "Replay.h"
+
+// What one turn did. Everything a player's screen needs to show the
+// turn: the inputs, so the shot can be flown again for the animation,
+// and the outcome and scores, so nothing depends on that flight
+// agreeing. Fixed size, and sent as is over the network.
+struct TurnResult {
+  int32_t action;       // One of ReplayAction
+  int32_t player;       // Whose turn it was
+  int32_t hit;          // Body the shot hit, -1 if none. For a salvo, the target if any of it hit.
+  int32_t hits;         // Missiles that hit the other player's planet
+  int32_t score[2];     // Scores after the turn
+  double speed;
+  double angle;
+};
+
+// Everything about a game that changes as it's played, small enough
+// to keep thousands of. The planets aren't kept; they come from the
+// seed whenever a turn needs them.
+struct MatchState {
+  uint64_t seed;        // Seed of the current layout
+  int32_t score[2];
+  int32_t player;       // Whose turn it is
+  int32_t shots;
+  int32_t over;         // Someone quit
+};
+
+// A game about to start with these settings
+MatchState startmatch(const ReplayHeader &);
+
+// Whether the settings' field has room for both players' planets.
+// If it hasn't, every shot ends the game.
+bool fieldplayable(const ReplayHeader &);
+
+// The rules of the game, without a screen: players alternate shots,
+// and hitting the other player's planet scores a point, however many
+// of a salvo hit it. The same game main.cpp plays, from the same
+// settings a replay starts with, so it can referee a game played
+// somewhere else or check a recording.
+//
+// Plays a turn for the player whose turn it is. action is REPLAY_NEW,
+// REPLAY_FIRE or REPLAY_QUIT, which ends the match. The turn is
+// played in the given layout (set up with replaysettings) and salvo,
+// after rebuilding the layout from the state's seed unless it already
+// holds it, so one layout can serve any number of games. A shot or
+// salvo flies until it lands or reaches the settings' maxsteps, which
+// a server playing for strangers should set.
+TurnResult playturn(MatchState &, const ReplayHeader &, Layout &, Salvo &, int, double, double);
+
+// One game, with its own layout
+class Match {
+
+
+  public:
+
+    Match(const ReplayHeader &);
+
+    TurnResult play(int, double, double);   // As playturn
+
+    int getplayer() const;        // Whose turn it is
+    int getshots() const;
+    const int * getscore() const;
+    bool isover() const;
+
+
+  protected:
+
+    ReplayHeader header;
+    Layout layout;
+    Salvo salvo;
+    MatchState state;
+
+};
+
+#endif
@@ -0,0 +1,139 @@
+#include<cstring>
+#include<cstdio>
+#include<cmath>
+#include<unistd.h>
+#include<netdb.h>
+#include<netinet/in.h>
+#include<netinet/tcp.h>
+#include<sys/socket.h>
+#include"Net.h"
+#include"Physics.h"
+
+// Turns go out as soon as they're written; they're too small for
+// Nagle's algorithm to be worth waiting on
+static void nodelay(int fd) {
+  int one = 1;
+  setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+}
+
+int netlisten(int port) {
+  int fd = socket(AF_INET6, SOCK_STREAM, 0);
+  if (fd < 0)
+    return -1;
+  int one = 1, zero = 0;
+  setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+  setsockopt(fd, IPPROTO_IPV6, IPV6_V6ONLY, &zero, sizeof(zero));   // IPv4 clients too
+  sockaddr_in6 addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin6_family = AF_INET6;
+  addr.sin6_addr = in6addr_any;
+  addr.sin6_port = htons(port);
+  if (bind(fd, (sockaddr *)&addr, sizeof(addr)) < 0 || listen(fd, SOMAXCONN) < 0) {   // bphost may have many players arriving at once
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+int netaccept(int listener) {
+  int fd = accept(listener, NULL, NULL);
+  if (fd >= 0)
+    nodelay(fd);
+  return fd;
+}
+
+int netconnect(const char * host, int port) {
+  char service[16];
+  snprintf(service, sizeof(service), "%d", port);
+  addrinfo hints;
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  addrinfo * found;
+  if (getaddrinfo(host, service, &hints, &found) != 0)
+    return -1;
+  int fd = -1;
+  for (addrinfo * a = found; a && fd < 0; a = a->ai_next) {
+    fd = socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+    if (fd >= 0 && connect(fd, a->ai_addr, a->ai_addrlen) < 0) {
+      close(fd);
+      fd = -1;
+    }
+  }
+  freeaddrinfo(found);
+  if (fd >= 0)
+    nodelay(fd);
+  return fd;
+}
+
+bool netsend(int fd, const void * data, size_t n) {
+  const char * p = (const char *)data;
+  while (n > 0) {
+    ssize_t sent = send(fd, p, n, MSG_NOSIGNAL);   // A closed peer is an error, not a SIGPIPE
+    if (sent <= 0)
+      return false;
+    p += sent;
+    n -= sent;
+  }
+  return true;
+}
+
+bool netrecv(int fd, void * data, size_t n) {
+  char * p = (char *)data;
+  while (n > 0) {
+    ssize_t got = recv(fd, p, n, 0);
+    if (got <= 0)
+      return false;
+    p += got;
+    n -= got;
+  }
+  return true;
+}
+
+bool sendhello(int fd, int player, const ReplayHeader & game) {
+  NetHello hello;
+  memset(&hello, 0, sizeof(hello));
+  memcpy(hello.magic, "BPNT", 4);
+  hello.version = NETVERSION;
+  hello.player = player;
+  hello.game = game;
+  return netsend(fd, &hello, sizeof(hello));
+}
+
+bool recvhello(int fd, int * player, ReplayHeader * game) {
+  NetHello hello;
+  if (!netrecv(fd, &hello, sizeof(hello)))
+    return false;
+  if (memcmp(hello.magic, "BPNT", 4) || hello.version != NETVERSION || (hello.player != 0 && hello.player != 1))
+    return false;
+  if (!validheader(hello.game))
+    return false;
+  *player = hello.player;
+  *game = hello.game;
+  return true;
+}
+
+bool sendturn(int fd, int action, double speed, double angle) {
+  NetTurn turn;
+  memset(&turn, 0, sizeof(turn));
+  turn.action = action;
+  turn.speed = speed;
+  turn.angle = angle;
+  return netsend(fd, &turn, sizeof(turn));
+}
+
+bool recvturn(int fd, NetTurn * turn) {
+  if (!netrecv(fd, turn, sizeof(*turn)))
+    return false;
+  if (turn->action != REPLAY_QUIT && turn->action != REPLAY_NEW && turn->action != REPLAY_FIRE)
+    return false;
+  return std::isfinite(turn->speed) && std::isfinite(turn->angle);
+}
+
+bool sendresult(int fd, const TurnResult & result) {
+  return netsend(fd, &result, sizeof(result));
+}
+
+bool recvresult(int fd, TurnResult * result) {
+  return netrecv(fd, result, sizeof(*result));
+}
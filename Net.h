@@ -0,0 +1,58 @@
+#ifndef NET_H
+#define NET_H
+
+#include <cstddef>
+#include <stdint.h>
+#include "Replay.h"
+#include "Match.h"
+
+// Two player games over TCP. The server referees with a Match and the
+// clients only draw. Nothing per frame crosses the network: a game
+// starts with the settings and seed, the same header a replay starts
+// with, and each turn is the player's input going up and the turn's
+// result coming back to both players. Each client flies the shot again
+// itself to animate it, and takes the hit and the scores from the
+// server. Every message has a fixed size, so a turn costs the same
+// few bytes however long the shot flies.
+//
+// Messages are the structs below, sent as they are in memory, like
+// the replay file. Both ends must be the same build.
+
+const int32_t NETVERSION = 3;
+
+// Server to each client on connecting
+struct NetHello {
+  char magic[4];        // "BPNT"
+  int32_t version;      // NETVERSION
+  int32_t player;       // Which player this client is, 0 or 1
+  int32_t reserved;
+  ReplayHeader game;
+};
+
+// Client to server, on its own turn
+struct NetTurn {
+  int32_t action;       // REPLAY_QUIT, REPLAY_NEW or REPLAY_FIRE
+  int32_t reserved;
+  double speed;
+  double angle;
+};
+
+// Server to both clients after every turn: a TurnResult (Match.h).
+// One with REPLAY_QUIT ends the game, and is also sent when the other
+// player disconnects or breaks the protocol.
+
+// Socket helpers. Each returns -1 or false on failure, with errno set.
+int netlisten(int);                     // Listening socket on a port, all addresses
+int netaccept(int);
+int netconnect(const char *, int);      // Host name or address, and port
+bool netsend(int, const void *, size_t);
+bool netrecv(int, void *, size_t);      // Exactly n bytes; false on EOF too
+
+bool sendhello(int, int, const ReplayHeader &);
+bool recvhello(int, int *, ReplayHeader *);    // False if it isn't a server of this version
+bool sendturn(int, int, double, double);
+bool recvturn(int, NetTurn *);                 // False if the action isn't a turn's
+bool sendresult(int, const TurnResult &);
+bool recvresult(int, TurnResult *);
+
+#endif
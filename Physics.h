@@ -0,0 +1,93 @@
+#ifndef PHYSICS_H
+#define PHYSICS_H
+
+#include <cmath>
+#include <cstring>
+
+// The constants the physics is built from, and the force laws a game
+// can be played under. They are all known at compile time: the force
+// kernels are templates on the law, so each law gets its own inner
+// loop with its constants folded in and nothing tested per body.
+// Which law a game uses is still a runtime setting; the kernel table,
+// the tree walk and the grid fill each pick their instance once per
+// call, outside the loop.
+
+// The game has always used this value. A closer one would move every
+// shot, and recorded games with them.
+constexpr double PI = 3.1415;
+
+// A character cell is twice as tall as it is wide, so distances and
+// movement along x count half
+constexpr double ASPECT = 2;
+
+// A body's mass is its size; a missile's is fixed
+inline double bodymass(int size) {
+  return size;
+}
+constexpr double MISSILEMASS = 3;
+
+// Force laws, as stored in a layout and a replay
+enum ForceLawKind {
+  FORCE_NEWTON,       // Inverse square, as the game has always played
+  FORCE_SOFTENED,     // Inverse square, eased off close in
+  FORCE_INVERSE,      // Inverse linear: a long, gentle pull
+  FORCELAWS
+};
+
+inline const char * forcelawname(int law) {
+  switch (law) {
+    case FORCE_SOFTENED:
+      return "softened";
+    case FORCE_INVERSE:
+      return "inverse";
+    default:
+      return "newton";
+  }
+}
+
+// "newton", "softened" or "inverse" to a ForceLawKind, -1 if unknown
+inline int parseforcelaw(const char * name) {
+  for (int k = 0; k < FORCELAWS; ++k) {
+    if (!strcmp(name, forcelawname(k)))
+      return k;
+  }
+  return -1;
+}
+
+// A law is a policy type. A body of mass m at offset (dx, dy) from the
+// missile, r2 = dx^2 + dy^2, pulls with
+//   G * m * (dx, dy) / (r2 + SOFTENING2)^(POWER / 2)
+// so POWER 3 is inverse square and 2 is inverse linear.
+
+struct NewtonLaw {
+  static constexpr int POWER = 3;
+  static constexpr double SOFTENING2 = 0;
+  static constexpr double G = 1;
+};
+
+// Plummer softening over two cells: a close pass bends the shot
+// rather than flinging it
+struct SoftenedLaw {
+  static constexpr int POWER = 3;
+  static constexpr double SOFTENING2 = 4;
+  static constexpr double G = 1;
+};
+
+// Scaled to pull as hard as NewtonLaw ten cells out
+struct InverseLinearLaw {
+  static constexpr int POWER = 2;
+  static constexpr double SOFTENING2 = 0;
+  static constexpr double G = 0.1;
+};
+
+// The multiple of (dx, dy) that a body of mass m pulls with at r2.
+// The tests are on constants, so they compile away; NewtonLaw comes
+// to m / (r2 * sqrt(r2)), exactly as before there were laws.
+template <class Law>
+inline double pullweight(double m, double r2) {
+  double s2 = (Law::SOFTENING2 != 0 ? r2 + Law::SOFTENING2 : r2);
+  double d = (Law::POWER == 3 ? s2 * sqrt(s2) : s2);
+  return (Law::G != 1 ? Law::G * m : m) / d;
+}
+
+#endif
@@ -0,0 +1,102 @@
+#ifndef POOL_H
+#define POOL_H
+
+#include <vector>
+#include <stdint.h>
+
+// Refers to an entry in a Pool. The generation says which use of the
+// slot it means, so a handle kept after its entry was destroyed, or
+// after the pool was cleared, is recognised as stale rather than
+// quietly finding whatever lives in the slot now.
+struct Handle {
+  uint32_t index;
+  uint32_t generation;
+};
+
+const Handle NOHANDLE = {0xffffffffu, 0};
+
+// Fixed-type arena for short-lived entities such as missiles. Entries
+// sit in one array and freed slots are reused last-freed first, so
+// creating and destroying is O(1) and, once the pool has grown to its
+// working size, never touches the heap. clear() frees everything at
+// once and keeps the memory.
+template<class T> class Pool {
+
+
+  public:
+
+    Pool() : live(0) {}
+
+    void reserve(int n) {
+      this->items.reserve(n);
+      this->generation.reserve(n);
+      this->freelist.reserve(n);
+    }
+
+    Handle create() {
+      Handle h;
+      if (!this->freelist.empty()) {
+        h.index = this->freelist.back();
+        this->freelist.pop_back();
+        this->items[h.index] = T();
+      }
+      else {
+        h.index = this->items.size();
+        this->items.push_back(T());
+        this->generation.push_back(1);
+      }
+      h.generation = this->generation[h.index];
+      ++this->live;
+      return h;
+    }
+
+    void destroy(Handle h) {
+      if (!this->alive(h))
+        return;
+      ++this->generation[h.index];          // Every handle to the old entry is now stale
+      this->freelist.push_back(h.index);
+      --this->live;
+    }
+
+    // Frees every entry, keeping the memory for the next round
+    void clear() {
+      this->freelist.clear();
+      for (uint32_t i = this->items.size(); i-- > 0; ) {
+        ++this->generation[i];
+        this->freelist.push_back(i);       // Lowest slots get reused first
+      }
+      this->live = 0;
+    }
+
+    bool alive(Handle h) const {
+      return h.index < this->generation.size() && this->generation[h.index] == h.generation;
+    }
+
+    // The entry, or NULL if the handle is stale
+    T * get(Handle h) {
+      return (this->alive(h) ? &this->items[h.index] : NULL);
+    }
+
+    const T * get(Handle h) const {
+      return (this->alive(h) ? &this->items[h.index] : NULL);
+    }
+
+    int count() const {
+      return this->live;
+    }
+
+    int capacity() const {
+      return this->items.capacity();
+    }
+
+
+  protected:
+
+    std::vector<T> items;
+    std::vector<uint32_t> generation;   // Bumped each time a slot's entry is freed
+    std::vector<uint32_t> freelist;
+    int live;
+
+};
+
+#endif
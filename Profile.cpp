@@ -0,0 +1,227 @@
+#include"Profile.h"
+
+#ifdef BP_PROFILE
+
+#include<atomic>
+#include<mutex>
+#include<cstdio>
+#include<cstdlib>
+#include<cstring>
+#include<csignal>
+#include<chrono>
+#include<stdint.h>
+
+// Log-linear histogram: exact below 8, then 8 buckets for every
+// power of two, so any percentile is within 12.5% of the true value
+class Histogram {
+
+
+  public:
+
+    Histogram() {
+      memset(this->counts, 0, sizeof this->counts);
+      this->n = 0;
+      this->max = 0;
+    }
+
+    void add(long v) {
+      ++this->counts[bucket(v)];
+      ++this->n;
+      if (v > this->max)
+        this->max = v;
+    }
+
+    // Upper end of the bucket holding the p'th fraction of the values
+    long percentile(double p) const {
+      if (this->n == 0)
+        return 0;
+      uint64_t want = (uint64_t)(p * this->n);
+      if (want >= this->n)
+        want = this->n - 1;
+      uint64_t seen = 0;
+      for (int i = 0; i < NBUCKETS; ++i) {
+        seen += this->counts[i];
+        if (seen > want)
+          return (upper(i) < this->max ? upper(i) : this->max);
+      }
+      return this->max;
+    }
+
+    long getmax() const {
+      return this->max;
+    }
+
+
+  protected:
+
+    static const int NBUCKETS = 512;
+
+    static int bucket(long v) {
+      if (v < 8)
+        return (v < 0 ? 0 : v);
+      int e = 63 - __builtin_clzl(v);
+      return (e - 2) * 8 + ((v >> (e - 3)) & 7);
+    }
+
+    static long upper(int i) {
+      if (i < 8)
+        return i;
+      int e = i / 8 + 2;
+      long low = (long)(8 + i % 8) << (e - 3);
+      return low + (1L << (e - 3)) - 1;
+    }
+
+    uint64_t counts[NBUCKETS];
+    uint64_t n;
+    long max;
+
+};
+
+static const char * zonenames[NPROFZONES] = {"force", "move", "collide", "draw", "present", "wait", "frame"};
+
+// Each thread records into its own block of counters, which only it
+// writes, so a record is two plain adds rather than locked ones.
+// Frames are cut by summing every block and taking the change since
+// the last frame. Blocks are kept in a list that only grows; a thread
+// that exits hands its block on to the next new one.
+struct ThreadCounters {
+  std::atomic<long> time[NPROFZONES];
+  std::atomic<long> calls[NPROFZONES];
+  std::atomic<bool> inuse;
+  ThreadCounters * next;
+  char pad[64];                             // Keeps neighbouring blocks off each other's cache lines
+};
+
+static std::atomic<ThreadCounters *> blocks(NULL);
+
+static ThreadCounters * claimblock() {
+  for (ThreadCounters * b = blocks.load(); b; b = b->next) {
+    bool idle = false;
+    if (b->inuse.compare_exchange_strong(idle, true))
+      return b;
+  }
+  ThreadCounters * b = new ThreadCounters;
+  for (int z = 0; z < NPROFZONES; ++z) {
+    b->time[z] = 0;
+    b->calls[z] = 0;
+  }
+  b->inuse = true;
+  b->next = blocks.load();
+  while (!blocks.compare_exchange_weak(b->next, b))
+    ;
+  return b;
+}
+
+struct BlockOwner {
+  ThreadCounters * block;
+  BlockOwner() : block(claimblock()) {}
+  ~BlockOwner() { this->block->inuse = false; }
+};
+
+static thread_local BlockOwner owner;
+
+// Totals over every thread so far
+static void sumblocks(long * time, long * calls) {
+  for (int z = 0; z < NPROFZONES; ++z)
+    time[z] = calls[z] = 0;
+  for (ThreadCounters * b = blocks.load(); b; b = b->next) {
+    for (int z = 0; z < NPROFZONES; ++z) {
+      time[z] += b->time[z].load(std::memory_order_relaxed);
+      calls[z] += b->calls[z].load(std::memory_order_relaxed);
+    }
+  }
+}
+
+static Histogram timehist[NPROFZONES];      // Ticks per frame
+static Histogram callhist[NPROFZONES];      // Calls per frame
+static long lasttime[NPROFZONES];           // Totals when the last frame was cut
+static long lastcalls[NPROFZONES];
+static long frames = 0;
+static std::mutex histlock;
+static const char * reportname = "battleplanets.prof";
+static volatile sig_atomic_t dumprequested = 0;
+
+// Where the tick counter and the clock stood at startup, to work out
+// how long a tick is when the report is written
+static const long startticks = profileticks();
+static const std::chrono::steady_clock::time_point starttime = std::chrono::steady_clock::now();
+
+static double nspertick() {
+  long ticks = profileticks() - startticks;
+  double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - starttime).count();
+  return (ticks > 0 ? ns / ticks : 1);
+}
+
+static void onsignal(int) {
+  dumprequested = 1;                        // Dumped from the next record or frame; file IO isn't safe here
+}
+
+static void onexit() {
+  long time[NPROFZONES], calls[NPROFZONES];
+  sumblocks(time, calls);
+  for (int z = 0; z < NPROFZONES; ++z) {
+    if (calls[z] != lastcalls[z]) {
+      profileframe();                       // The unfinished frame still counts
+      break;
+    }
+  }
+  profiledump();
+}
+
+void profilestart(const char * name) {
+  if (name)
+    reportname = name;
+  signal(SIGUSR1, onsignal);
+  atexit(onexit);
+}
+
+void profilerecord(int zone, long ticks) {
+  ThreadCounters * b = owner.block;
+  b->time[zone].store(b->time[zone].load(std::memory_order_relaxed) + ticks, std::memory_order_relaxed);
+  b->calls[zone].store(b->calls[zone].load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+  if (dumprequested) {
+    dumprequested = 0;
+    profiledump();
+  }
+}
+
+void profileframe() {
+  {
+    std::lock_guard<std::mutex> lock(histlock);
+    long time[NPROFZONES], calls[NPROFZONES];
+    sumblocks(time, calls);
+    for (int z = 0; z < NPROFZONES; ++z) {
+      timehist[z].add(time[z] - lasttime[z]);
+      callhist[z].add(calls[z] - lastcalls[z]);
+      lasttime[z] = time[z];
+      lastcalls[z] = calls[z];
+    }
+    ++frames;
+  }
+  if (dumprequested) {
+    dumprequested = 0;
+    profiledump();
+  }
+}
+
+void profiledump() {
+  std::lock_guard<std::mutex> lock(histlock);
+  FILE * out = fopen(reportname, "w");
+  if (!out)
+    return;
+  double scale = nspertick() / 1e3;          // Microseconds per tick
+  long time[NPROFZONES], calls[NPROFZONES];
+  sumblocks(time, calls);
+  fprintf(out, "%ld frames\n\n", frames);
+  fprintf(out, "%-8s %12s %12s | %-24s | %s\n", "zone", "calls", "total ms",
+          "calls/frame p50 p99 max", "us/frame p50 p99 max");
+  for (int z = 0; z < NPROFZONES; ++z) {
+    fprintf(out, "%-8s %12ld %12.2f | %6ld %8ld %8ld | %10.1f %10.1f %10.1f\n", zonenames[z],
+            calls[z], time[z] * scale / 1e3,
+            callhist[z].percentile(0.5), callhist[z].percentile(0.99), callhist[z].getmax(),
+            timehist[z].percentile(0.5) * scale, timehist[z].percentile(0.99) * scale, timehist[z].getmax() * scale);
+  }
+  fclose(out);
+}
+
+#endif
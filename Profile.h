@@ -0,0 +1,80 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+// Hot-path timers for finding where a turn's time goes. Built with
+// -DBP_PROFILE ("make PROFILE=1" after a "make clean"), each
+// PROFILE_SCOPE times the rest of its block against a zone, and each
+// PROFILE_FRAME ends a frame: the time and calls every zone took in
+// it go into that zone's histograms. Without BP_PROFILE the macros
+// expand to nothing and none of this is compiled in.
+//
+// The report, with p50/p99/max per frame for every zone, is written
+// on exit and whenever the process gets SIGUSR1, to the file given to
+// PROFILE_START (battleplanets.prof if that's null).
+
+enum ProfileZone {
+  PROF_FORCE,         // Body::getforce and the integrators' field lookups
+  PROF_MOVE,          // setvelocity and movebody
+  PROF_COLLIDE,       // checkcollision and the swept tests
+  PROF_DRAW,          // Drawing and erasing bodies
+  PROF_PRESENT,       // Sending a frame to the terminal
+  PROF_WAIT,          // Sleeping until the next step is due
+  PROF_FRAME,         // The whole frame
+  NPROFZONES
+};
+
+#ifdef BP_PROFILE
+
+#include <chrono>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// Timestamp for the scopes. The cycle counter costs a few ns where
+// there is one; the report converts ticks to time.
+inline long profileticks() {
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#else
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+void profilestart(const char *);           // Report file; also installs the signal handler
+void profilerecord(int, long);             // One call to a zone, taking the given ticks
+void profileframe();                       // Closes the current frame
+void profiledump();                        // Writes the report now
+
+class ProfileScope {
+
+
+  public:
+
+    explicit ProfileScope(int zone) : zone(zone), start(profileticks()) {}
+    ~ProfileScope() {
+      profilerecord(this->zone, profileticks() - this->start);
+    }
+
+
+  protected:
+
+    int zone;
+    long start;
+
+};
+
+#define PROFILE_JOIN2(a, b) a##b
+#define PROFILE_JOIN(a, b) PROFILE_JOIN2(a, b)
+#define PROFILE_SCOPE(zone) ProfileScope PROFILE_JOIN(profilescope, __LINE__)(zone)
+#define PROFILE_FRAME() profileframe()
+#define PROFILE_START(file) profilestart(file)
+
+#else
+
+#define PROFILE_SCOPE(zone) ((void)0)
+#define PROFILE_FRAME() ((void)0)
+#define PROFILE_START(file) ((void)0)
+
+#endif
+
+#endif
@@ -0,0 +1,223 @@
+#include<cmath>
+#include<random>
+#include"QuadTree.h"
+#include"BodyStore.h"
+#include"Gravity.h"
+#include"Physics.h"
+
+// Distance units in the x-direction are shorter, so the tree is
+// built over (x / ASPECT, y) to keep its cells square.
+
+static const int MAXDEPTH = 48;   // Bodies this close together just share a leaf
+
+QuadTree::QuadTree(double t) {
+  this->theta = t;
+}
+
+void QuadTree::settheta(double t) {
+  this->theta = t;
+}
+
+double QuadTree::gettheta() const {
+  return this->theta;
+}
+
+void QuadTree::clear() {
+  this->nodes.clear();
+}
+
+bool QuadTree::empty() const {
+  return this->nodes.empty();
+}
+
+int QuadTree::nodecount() const {
+  return this->nodes.size();
+}
+
+int QuadTree::newnode(double midx, double midy, double half) {
+  Node n;
+  n.comx = 0;
+  n.comy = 0;
+  n.mass = 0;
+  n.midx = midx;
+  n.midy = midy;
+  n.half = half;
+  n.child[0] = n.child[1] = n.child[2] = n.child[3] = -1;
+  n.body = -1;
+  this->nodes.push_back(n);
+  return this->nodes.size() - 1;
+}
+
+void QuadTree::build(const BodyStore & bodies) {
+  this->nodes.clear();
+  int n = bodies.count();
+  if (n == 0)
+    return;
+
+  // Find the bounding square of all the bodies
+  double minx = bodies.getx(0) / ASPECT, maxx = minx;
+  double miny = bodies.gety(0), maxy = miny;
+  for (int i = 1; i < n; ++i) {
+    double bx = bodies.getx(i) / ASPECT;
+    double by = bodies.gety(i);
+    minx = fmin(minx, bx);
+    maxx = fmax(maxx, bx);
+    miny = fmin(miny, by);
+    maxy = fmax(maxy, by);
+  }
+  double half = fmax(maxx - minx, maxy - miny) / 2 + 1;
+
+  this->nodes.reserve(2 * n);
+  newnode((minx + maxx) / 2, (miny + maxy) / 2, half);
+  for (int i = 0; i < n; ++i) {
+    insert(0, i, bodies.getx(i) / ASPECT, bodies.gety(i), bodies.getmass(i), 0);
+  }
+}
+
+// Adds body b at (bx, by) with mass m to the subtree at node,
+// keeping each node's center of mass up to date on the way down
+void QuadTree::insert(int node, int b, double bx, double by, double m, int depth) {
+  Node * cur = &this->nodes[node];
+
+  if (cur->mass == 0) {         // An empty node becomes a leaf holding b
+    cur->comx = bx;
+    cur->comy = by;
+    cur->mass = m;
+    cur->body = b;
+    return;
+  }
+
+  // A leaf's center of mass is its body's position
+  int old = cur->body;
+  double oldx = cur->comx;
+  double oldy = cur->comy;
+  double oldm = cur->mass;
+
+  double total = cur->mass + m;
+  cur->comx = (cur->comx * cur->mass + bx * m) / total;
+  cur->comy = (cur->comy * cur->mass + by * m) / total;
+  cur->mass = total;
+
+  if (depth >= MAXDEPTH)        // Too deep to split; the leaf just gets heavier
+    return;
+
+  // A leaf must push its old body down before taking a second one
+  if (old >= 0) {
+    cur->body = -1;
+    int q = (oldx >= cur->midx) + 2 * (oldy >= cur->midy);
+    double h = cur->half / 2;
+    int c = newnode(cur->midx + (q & 1 ? h : -h), cur->midy + (q & 2 ? h : -h), h);
+    this->nodes[node].child[q] = c;   // newnode may have moved the vector
+    insert(c, old, oldx, oldy, oldm, depth + 1);
+  }
+
+  cur = &this->nodes[node];
+  int q = (bx >= cur->midx) + 2 * (by >= cur->midy);
+  int c = cur->child[q];
+  if (c < 0) {
+    double h = cur->half / 2;
+    c = newnode(cur->midx + (q & 1 ? h : -h), cur->midy + (q & 2 ? h : -h), h);
+    this->nodes[node].child[q] = c;
+  }
+  insert(c, b, bx, by, m, depth + 1);
+}
+
+void QuadTree::getforce(double px, double py, double m, double * force, int law) const {
+  switch (law) {
+    case FORCE_SOFTENED:
+      this->walk<SoftenedLaw>(px, py, m, force);
+      break;
+    case FORCE_INVERSE:
+      this->walk<InverseLinearLaw>(px, py, m, force);
+      break;
+    default:
+      this->walk<NewtonLaw>(px, py, m, force);
+      break;
+  }
+}
+
+template <class Law>
+void QuadTree::walk(double px, double py, double m, double * force) const {
+  double ax = 0;
+  double ay = 0;
+  if (this->nodes.empty()) {
+    force[0] = force[1] = 0;
+    return;
+  }
+
+  double hx = px / ASPECT;
+  double theta2 = this->theta * this->theta;
+  int stack[4 * MAXDEPTH + 4];
+  int top = 0;
+  stack[top++] = 0;
+
+  while (top) {
+    const Node & n = this->nodes[stack[--top]];
+    double dx = n.comx - hx;
+    double dy = n.comy - py;
+    double r2 = dx * dx + dy * dy;
+    double side = 2 * n.half;
+    bool leaf = (n.child[0] < 0 && n.child[1] < 0 && n.child[2] < 0 && n.child[3] < 0);
+
+    bool outside = (fabs(hx - n.midx) > n.half || fabs(py - n.midy) > n.half);
+
+    if (leaf || (outside && side * side < theta2 * r2)) {   // Far enough away to treat as one mass
+      if (r2 == 0)
+        continue;
+      double w = pullweight<Law>(n.mass, r2);
+      ax += w * dx;
+      ay += w * dy;
+    }
+    else {
+      for (int q = 0; q < 4; ++q) {
+        if (n.child[q] >= 0)
+          stack[top++] = n.child[q];
+      }
+    }
+  }
+
+  force[0] = m * ax;
+  force[1] = m * ay;
+}
+
+
+double bhcheck(const BodyStore & bodies, const QuadTree & tree, int samples, int nlines, int ncols, int law,
+               uint64_t seed, double * maxerr, int * taken) {
+  double sumsq = 0;
+  *taken = 0;
+  *maxerr = 0;
+  if (nlines <= 0 || ncols <= 0)
+    return 0;
+
+  // A field that is all planets, or has none, has few points to
+  // sample or none, so give up after a while rather than look forever
+  std::mt19937_64 rng(seed);
+  for (long attempt = 0; *taken < samples && attempt < 20L * samples; ++attempt) {
+    double px = rng() % ncols + 0.5;
+    double py = rng() % nlines + 0.5;
+
+    // Skip points inside a body, where a missile would already have collided
+    bool inside = false;
+    for (int i = 0; i < bodies.count() && !inside; ++i) {
+      double dx = (px - bodies.getx(i)) / ASPECT;
+      double dy = py - bodies.gety(i);
+      inside = (dx * dx + dy * dy < bodies.getradius(i) * bodies.getradius(i));
+    }
+    if (inside)
+      continue;
+
+    double exact[2], approx[2];
+    sumforce(bodies, px, py, 1, exact, law);
+    tree.getforce(px, py, 1, approx, law);
+    double ex = approx[0] - exact[0];
+    double ey = approx[1] - exact[1];
+    double mag = sqrt(exact[0] * exact[0] + exact[1] * exact[1]);
+    if (mag == 0)
+      continue;
+    double err = sqrt(ex * ex + ey * ey) / mag;
+    sumsq += err * err;
+    *maxerr = fmax(*maxerr, err);
+    ++*taken;
+  }
+  return (*taken > 0 ? sqrt(sumsq / *taken) : 0);
+}
@@ -0,0 +1,63 @@
+#ifndef QUADTREE_H
+#define QUADTREE_H
+
+#include <vector>
+#include <stdint.h>
+
+class BodyStore;
+
+// Barnes-Hut quadtree over a fixed set of bodies. Built once per
+// layout, then used to approximate the gravity sum in O(log n).
+// Groups of bodies whose cell size over distance is below the
+// opening angle are treated as a single mass at their center.
+class QuadTree {
+
+
+  public:
+
+    QuadTree(double = 0.5);
+
+    void build(const BodyStore &);
+    void clear();
+    bool empty() const;
+    int nodecount() const;
+
+    // Opening angle. 0 gives the exact sum, larger is faster and rougher.
+    void settheta(double);
+    double gettheta() const;
+
+    // Same contract as sumforce() in Gravity.h, law and all
+    void getforce(double, double, double, double *, int) const;
+
+
+  protected:
+
+    struct Node {
+      double comx, comy;   // Center of mass, x already divided by ASPECT
+      double mass;
+      double midx, midy;   // Center of the square this node covers
+      double half;         // Half the side of the square
+      int child[4];        // Index of each quadrant, -1 if empty
+      int body;            // Body index for a leaf, -1 for an internal node
+    };
+
+    int newnode(double, double, double);
+    template <class Law> void walk(double, double, double, double *) const;
+    void insert(int, int, double, double, double, int);
+
+    std::vector<Node> nodes;
+    double theta;
+
+};
+
+// Number of bodies above which fireproj switches to the quadtree
+const int BH_THRESHOLD = 1000;
+
+// Compares the quadtree against the exact sum at up to "samples"
+// random points in the field, under a force law, drawn from the seed.
+// Points inside bodies are skipped, and it stops trying after 20 times
+// as many points as it wanted. Returns the RMS relative error, and
+// writes the worst one and the number of points it used.
+double bhcheck(const BodyStore &, const QuadTree &, int, int, int, int, uint64_t, double *, int *);
+
+#endif
@@ -0,0 +1,146 @@
+#include<cstring>
+#include"Replay.h"
+#include"Sim.h"
+#include"Match.h"
+
+ReplayWriter::ReplayWriter() {
+  this->out = NULL;
+}
+
+ReplayWriter::~ReplayWriter() {
+  if (this->out)
+    fclose(this->out);
+}
+
+bool ReplayWriter::open(const char * name, const ReplayHeader & header) {
+  this->out = fopen(name, "wb");
+  if (!this->out)
+    return false;
+  int32_t version = REPLAYVERSION;
+  bool ok = fwrite("BPRV", 1, 4, this->out) == 4;
+  ok = ok && fwrite(&version, sizeof(version), 1, this->out) == 1;
+  ok = ok && fwrite(&header, sizeof(header), 1, this->out) == 1;
+  fflush(this->out);
+  return ok;
+}
+
+void ReplayWriter::turn(int action, double speed, double angle) {
+  if (!this->out)
+    return;
+  uint8_t code = action;
+  fwrite(&code, 1, 1, this->out);
+  if (action == REPLAY_FIRE) {
+    double shot[2] = {speed, angle};
+    fwrite(shot, sizeof(shot), 1, this->out);
+  }
+  fflush(this->out);
+}
+
+void ReplayWriter::finish(const int * score) {
+  if (!this->out)
+    return;
+  uint8_t code = REPLAY_QUIT;
+  int32_t scores[2] = {score[0], score[1]};
+  fwrite(&code, 1, 1, this->out);
+  fwrite(scores, sizeof(scores), 1, this->out);
+  fclose(this->out);
+  this->out = NULL;
+}
+
+ReplayHeader replayheader(const Layout & layout, uint64_t seed, int nlines, int ncols, bool usegrid, int salvo, double spread) {
+  ReplayHeader header;
+  memset(&header, 0, sizeof(header));         // No stray padding bytes in the file
+  header.seed = seed;
+  header.nlines = nlines;
+  header.ncols = ncols;
+  header.integrator = layout.integrator;
+  header.forcelaw = layout.forcelaw;
+  header.gridres = (usegrid ? layout.grid.getresolution() : 0);
+  header.swept = layout.swept;
+  header.tolerance = layout.tolerance;
+  header.theta = layout.tree.gettheta();
+  header.salvo = salvo;
+  header.spread = spread;
+  return header;
+}
+
+void replaysettings(const ReplayHeader & header, Layout & layout) {
+  layout.integrator = header.integrator;
+  layout.forcelaw = header.forcelaw;
+  layout.swept = header.swept;
+  layout.tolerance = header.tolerance;
+  layout.tree.settheta(header.theta);
+  if (header.gridres > 0)
+    layout.grid.setresolution(header.gridres);
+}
+
+bool validheader(const ReplayHeader & h) {
+  return h.nlines > 0 && h.nlines <= MAXFIELD && h.ncols > 0 && h.ncols <= MAXFIELD
+      && h.integrator >= INTEGRATE_EULER && h.integrator <= INTEGRATE_RK45
+      && h.forcelaw >= 0 && h.forcelaw < FORCELAWS
+      && h.gridres >= 0 && h.gridres <= MAXGRIDRES
+      && h.salvo >= 0 && h.salvo <= MAXSALVO
+      && (h.salvo <= 1 || h.integrator == INTEGRATE_EULER)   // Salvos only fly Euler steps
+      && h.maxsteps >= 0
+      && h.tolerance > 0 && h.tolerance <= MAXTOLERANCE       // Also false for NaN
+      && h.theta >= 0 && h.theta <= MAXTHETA
+      && h.spread >= 0 && h.spread <= 360;
+}
+
+int shotsteps(const ReplayHeader & h) {
+  return (h.maxsteps > 0 ? h.maxsteps : INT_MAX);
+}
+
+bool readreplay(const char * name, Replay & replay) {
+  FILE * in = fopen(name, "rb");
+  if (!in)
+    return false;
+  char magic[4];
+  int32_t version;
+  bool ok = fread(magic, 1, 4, in) == 4 && !memcmp(magic, "BPRV", 4);
+  ok = ok && fread(&version, sizeof(version), 1, in) == 1 && version == REPLAYVERSION;
+  ok = ok && fread(&replay.header, sizeof(replay.header), 1, in) == 1;
+  ok = ok && validheader(replay.header);
+  replay.turns.clear();
+  replay.finished = false;
+  uint8_t code;
+  while (ok && fread(&code, 1, 1, in) == 1) {
+    ReplayTurn turn = {code, 0, 0};
+    if (code == REPLAY_QUIT) {
+      int32_t scores[2];
+      if (fread(scores, sizeof(scores), 1, in) == 1) {
+        replay.finished = true;
+        replay.score[0] = scores[0];
+        replay.score[1] = scores[1];
+      }
+      break;
+    }
+    else if (code == REPLAY_FIRE) {
+      double shot[2];
+      if (fread(shot, sizeof(shot), 1, in) != 1)
+        break;                                // Cut off mid-turn; keep what came before
+      turn.speed = shot[0];
+      turn.angle = shot[1];
+    }
+    else if (code != REPLAY_NEW) {
+      ok = false;
+      break;
+    }
+    replay.turns.push_back(turn);
+  }
+  fclose(in);
+  return ok;
+}
+
+// The same rules as the game loop in main.cpp, refereed by a Match
+int playreplay(const Replay & replay, int * score) {
+  Match match(replay.header);
+  for (size_t i = 0; i < replay.turns.size(); ++i) {
+    const ReplayTurn & turn = replay.turns[i];
+    if (turn.action == REPLAY_NEW || turn.action == REPLAY_FIRE)
+      match.play(turn.action, turn.speed, turn.angle);
+  }
+  score[0] = match.getscore()[0];
+  score[1] = match.getscore()[1];
+  return match.getshots();
+}
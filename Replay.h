@@ -0,0 +1,110 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <cstdio>
+#include <climits>
+#include <vector>
+#include <stdint.h>
+
+struct Layout;
+
+// A recorded game: the settings every shot depends on, then each
+// turn's input. Layouts come from the seed, so the planets aren't
+// stored, and the physics is deterministic, so neither are the shots.
+//
+// The file is the "BPRV" magic, REPLAYVERSION as an int32 and a
+// ReplayHeader, then one byte per turn for the action, followed by the
+// speed and angle as doubles for shots. A game that ends normally
+// closes with REPLAY_QUIT and both scores as int32s. Files from before
+// there was a version start "BPRP" and aren't read.
+
+// Bumped whenever ReplayHeader or the turns change
+const int32_t REPLAYVERSION = 3;
+
+// Largest salvo, field grid resolution, field side, Barnes-Hut theta
+// and RK45 tolerance a header may ask for
+const int MAXSALVO = 10000;
+const int MAXGRIDRES = 16;
+const int MAXFIELD = 10000;
+const double MAXTHETA = 2;
+const double MAXTOLERANCE = 1;
+
+// Turn actions. The same codes inputparam returns in main.cpp.
+enum ReplayAction {
+  REPLAY_QUIT = 0,
+  REPLAY_NEW = 2,       // New planet layout, from the next seed
+  REPLAY_FIRE = 3
+};
+
+struct ReplayHeader {
+  uint64_t seed;        // Seed of the first layout
+  int32_t nlines;       // Terminal size the game was played at
+  int32_t ncols;
+  int32_t integrator;
+  int32_t gridres;      // Field grid resolution, 0 if it wasn't used
+  int32_t swept;
+  int32_t salvo;        // Missiles per shot; 0 or 1 for single shots
+  int32_t forcelaw;     // ForceLawKind
+  int32_t maxsteps;     // Steps a shot or salvo may fly, 0 for no limit
+  double tolerance;
+  double theta;
+  double spread;        // Degrees a salvo's angles are spread over
+};
+
+struct ReplayTurn {
+  int action;           // One of ReplayAction
+  double speed;
+  double angle;
+};
+
+struct Replay {
+  ReplayHeader header;
+  std::vector<ReplayTurn> turns;
+  bool finished;        // Ended with REPLAY_QUIT, so score is known
+  int score[2];
+};
+
+// Writes a game out as it is played, a turn at a time, so a crash
+// still leaves everything up to it
+class ReplayWriter {
+
+
+  public:
+
+    ReplayWriter();
+    ~ReplayWriter();
+
+    bool open(const char *, const ReplayHeader &);
+    void turn(int, double = 0, double = 0);
+    void finish(const int *);        // Final scores; closes the file
+
+
+  protected:
+
+    FILE * out;
+
+};
+
+// Header for a game about to be played with this layout's settings
+// (and salvo size and spread)
+ReplayHeader replayheader(const Layout &, uint64_t, int, int, bool, int, double);
+
+// Sets up a layout for a replay's settings, ready for arrangeplanets
+void replaysettings(const ReplayHeader &, Layout &);
+
+// True if every setting in the header is one the game can play
+bool validheader(const ReplayHeader &);
+
+// Steps a shot or salvo may fly in a game with these settings; INT_MAX
+// if there is no limit
+int shotsteps(const ReplayHeader &);
+
+// Reads a replay written by ReplayWriter. Returns false if it isn't
+// one, is from another version, or has settings out of range.
+bool readreplay(const char *, Replay &);
+
+// Replays a game without drawing it, as fast as the physics goes, and
+// fills in the scores it ends with. Returns the number of shots fired.
+int playreplay(const Replay &, int *);
+
+#endif
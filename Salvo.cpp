@@ -0,0 +1,259 @@
+#include<cmath>
+#include"Salvo.h"
+#include"Sim.h"
+#include"Gravity.h"
+#include"Profile.h"
+
+Salvo::Salvo(const Layout & field) {
+  this->layout = &field;
+  this->generation = field.generation;
+  this->source = SOURCE_SUM;
+}
+
+void Salvo::reserve(int n) {
+  this->missiles.reserve(n);
+  this->fired.reserve(n);
+  this->px.reserve(n);
+  this->py.reserve(n);
+  this->pvx.reserve(n);
+  this->pvy.reserve(n);
+  this->ox.resize(n);
+  this->oy.resize(n);
+  this->ax.resize(n);
+  this->ay.resize(n);
+  this->psteps.reserve(n);
+  this->id.reserve(n);
+}
+
+void Salvo::clear() {
+  this->missiles.clear();
+  this->fired.clear();
+  this->px.clear();
+  this->py.clear();
+  this->pvx.clear();
+  this->pvy.clear();
+  this->psteps.clear();
+  this->id.clear();
+  this->generation = this->layout->generation;
+}
+
+Handle Salvo::fire(double speed, double angle, int shooter) {
+  if (this->id.empty()) {
+    this->generation = this->layout->generation;
+    this->source = forcesource(*this->layout);   // Kept until every missile has landed, as a Shot keeps its own
+  }
+  const BodyStore & planets = this->layout->planets;
+  Missile m(planets.getx(shooter), planets.gety(shooter), speed, angle, LAUNCHRADIUS);   // Same launch point and velocity as a Shot
+  Handle h = this->missiles.create();
+  Record * r = this->missiles.get(h);
+  r->x = m.getx();
+  r->y = m.gety();
+  r->outcome = SHOT_FLYING;
+  r->hit = -1;
+  r->steps = 0;
+  r->slot = this->id.size();
+  this->fired.push_back(h);
+
+  this->px.push_back(m.getx());
+  this->py.push_back(m.gety());
+  this->pvx.push_back(m.getvx());
+  this->pvy.push_back(m.getvy());
+  this->psteps.push_back(0);
+  this->id.push_back(h);
+  return h;
+}
+
+void Salvo::firespread(int n, double speed, double angle, double spread, int shooter) {
+  this->reserve(this->count() + n);
+  for (int k = 0; k < n; ++k) {
+    double offset = (n > 1 ? spread * k / (n - 1) - spread / 2 : 0);
+    this->fire(speed, angle + offset, shooter);
+  }
+}
+
+// Takes the missile in slot k out of flight. The last slot moves
+// into its place, so slots past k are untouched.
+void Salvo::retire(int k, int how, int body) {
+  Record * r = this->missiles.get(this->id[k]);
+  r->x = this->px[k];
+  r->y = this->py[k];
+  r->outcome = how;
+  r->hit = body;
+  r->steps = this->psteps[k];
+  r->slot = -1;
+
+  int last = this->id.size() - 1;
+  if (k != last) {
+    this->px[k] = this->px[last];
+    this->py[k] = this->py[last];
+    this->pvx[k] = this->pvx[last];
+    this->pvy[k] = this->pvy[last];
+    this->ox[k] = this->ox[last];
+    this->oy[k] = this->oy[last];
+    this->psteps[k] = this->psteps[last];
+    this->id[k] = this->id[last];
+    this->missiles.get(this->id[k])->slot = k;
+  }
+  this->px.pop_back();
+  this->py.pop_back();
+  this->pvx.pop_back();
+  this->pvy.pop_back();
+  this->psteps.pop_back();
+  this->id.pop_back();
+}
+
+int Salvo::step() {
+  const Layout & field = *this->layout;
+  int n = this->id.size();
+  if (n == 0)
+    return 0;
+  if (this->generation != field.generation) {
+    this->stop();                 // The planets changed under it; none of these can land anywhere that means anything
+    return 0;
+  }
+  if ((int)this->ax.size() < n) {
+    this->ax.resize(n);
+    this->ay.resize(n);
+    this->ox.resize(n);
+    this->oy.resize(n);
+  }
+  double * ax = this->ax.data();
+  double * ay = this->ay.data();
+
+  // Force, for every missile at once where it pays. Large fields use
+  // the tree or the baked grid a missile at a time, as Shot does.
+  {
+    PROFILE_SCOPE(PROF_FORCE);
+    if (this->source == SOURCE_GRID) {
+      for (int k = 0; k < n; ++k) {
+        double a[2];
+        field.grid.getforce(this->px[k], this->py[k], 1, a);
+        ax[k] = a[0];
+        ay[k] = a[1];
+      }
+    }
+    else if (this->source == SOURCE_TREE) {
+      for (int k = 0; k < n; ++k) {
+        double a[2];
+        field.tree.getforce(this->px[k], this->py[k], 1, a, field.forcelaw);
+        ax[k] = a[0];
+        ay[k] = a[1];
+      }
+    }
+    else {
+      sumaccelbatch(field.planets, this->px.data(), this->py.data(), n, ax, ay, field.forcelaw);
+    }
+  }
+
+  // Euler step, as Body::setvelocity and Body::movebody, for all of them
+  {
+    PROFILE_SCOPE(PROF_MOVE);
+    double * x = this->px.data();
+    double * y = this->py.data();
+    double * vx = this->pvx.data();
+    double * vy = this->pvy.data();
+    double * ox = this->ox.data();
+    double * oy = this->oy.data();
+    int * st = this->psteps.data();
+    for (int k = 0; k < n; ++k) {
+      ox[k] = x[k];
+      oy[k] = y[k];
+      vx[k] += ax[k];
+      vy[k] += ay[k];
+      x[k] += vx[k];
+      y[k] += vy[k] / ASPECT;
+      ++st[k];
+    }
+  }
+
+  // Collisions and edges, from the last slot down so retiring one
+  // only moves a missile that's already been checked
+  {
+    PROFILE_SCOPE(PROF_COLLIDE);
+    for (int k = n - 1; k >= 0; --k) {
+      if (field.swept) {
+        Contact c;
+        double t;
+        bool hitbody = field.hash.sweep(this->ox[k], this->oy[k], this->px[k], this->py[k], &c);
+        bool offside = sweepsides(this->ox[k], this->oy[k], this->px[k], this->py[k], field.ncols, field.nlines, &t);
+        if (hitbody && (!offside || c.t <= t)) {
+          this->px[k] = c.x;
+          this->py[k] = c.y;
+          this->retire(k, SHOT_HIT, c.body);
+        }
+        else if (offside) {
+          this->px[k] = this->ox[k] + t * (this->px[k] - this->ox[k]);
+          this->py[k] = this->oy[k] + t * (this->py[k] - this->oy[k]);
+          this->retire(k, SHOT_OFFSCREEN, -1);
+        }
+        continue;
+      }
+      int body = field.hash.query(this->px[k], this->py[k]);
+      if (body >= 0) {
+        this->retire(k, SHOT_HIT, body);
+        continue;
+      }
+      int cx = floor(this->px[k]);
+      int cy = floor(this->py[k]);
+      if (!(cx < field.ncols - 2 && cx > 1 && cy < field.nlines - 3 && cy > 2))   // As checkSides
+        this->retire(k, SHOT_OFFSCREEN, -1);
+    }
+  }
+  return this->id.size();
+}
+
+void Salvo::stop() {
+  while (!this->id.empty())
+    this->retire(this->id.size() - 1, SHOT_TIMEOUT, -1);
+}
+
+int Salvo::count() const {
+  return this->fired.size();
+}
+
+int Salvo::flying() const {
+  return this->id.size();
+}
+
+Handle Salvo::missile(int i) const {
+  return this->fired[i];
+}
+
+double Salvo::getx(Handle h) const {
+  const Record * r = this->missiles.get(h);
+  if (!r)
+    return 0;
+  return (r->slot >= 0 ? this->px[r->slot] : r->x);
+}
+
+double Salvo::gety(Handle h) const {
+  const Record * r = this->missiles.get(h);
+  if (!r)
+    return 0;
+  return (r->slot >= 0 ? this->py[r->slot] : r->y);
+}
+
+int Salvo::getoutcome(Handle h) const {
+  const Record * r = this->missiles.get(h);
+  return (r ? r->outcome : SHOT_TIMEOUT);
+}
+
+int Salvo::gethit(Handle h) const {
+  const Record * r = this->missiles.get(h);
+  return (r ? r->hit : -1);
+}
+
+int Salvo::getsteps(Handle h) const {
+  const Record * r = this->missiles.get(h);
+  if (!r)
+    return 0;
+  return (r->slot >= 0 ? this->psteps[r->slot] : r->steps);
+}
+
+int Salvo::flyingcellx(int k) const {
+  return floor(this->px[k]);
+}
+
+int Salvo::flyingcelly(int k) const {
+  return floor(this->py[k]);
+}
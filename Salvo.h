@@ -0,0 +1,106 @@
+#ifndef SALVO_H
+#define SALVO_H
+
+#include <vector>
+#include <stdint.h>
+#include "Pool.h"
+
+struct Layout;
+
+// Many missiles in flight at once. Missiles still flying are packed
+// into arrays, one per property, and each step runs every pass over
+// all of them together: the force for all of them in one vectorised
+// call, then the moves, then the collision and edge checks. A missile
+// that lands is swapped out of the packed arrays and its result kept.
+//
+// Always moves missiles by Euler steps, like the game's default. The
+// force sums add in a different order from Shot's, so a long shot can
+// drift from the same Shot by rounding. The layout's integrator is
+// ignored, so the tools refuse a salvo with any other, and salvos
+// don't feed a layout's trajectory sink.
+//
+// Missiles live in a Pool and are named by handles. clear() readies
+// the salvo for the next shot and keeps every array's memory, so a
+// salvo kept from shot to shot stops allocating once it has flown
+// its largest volley. Handles from before a clear() are stale, and
+// the getters give nothing for them. If the layout is rebuilt with
+// missiles still flying, the next step ends them rather than fly
+// them through planets they were never fired among.
+class Salvo {
+
+
+  public:
+
+    Salvo(const Layout &);
+
+    void reserve(int);
+
+    // Forgets every missile, flying or not, keeping the memory
+    void clear();
+
+    // Launches a missile from planet "shooter" at the given speed and
+    // angle (degrees), as Shot would
+    Handle fire(double, double, int);
+
+    // Launches n missiles at the same speed, their angles spread
+    // evenly over "spread" degrees centered on the given angle
+    void firespread(int, double, double, double, int);
+
+    // Moves every flying missile one frame. Returns how many are
+    // still flying.
+    int step();
+
+    // Ends every missile still flying as SHOT_TIMEOUT
+    void stop();
+
+    int count() const;
+    int flying() const;
+
+    // The i'th missile fired since the last clear()
+    Handle missile(int) const;
+
+    // A missile by handle. A stale handle gets position 0, outcome
+    // SHOT_TIMEOUT, no hit and no steps.
+    double getx(Handle) const;
+    double gety(Handle) const;
+    int getoutcome(Handle) const;
+    int gethit(Handle) const;
+    int getsteps(Handle) const;
+
+    // Screen cell of the k'th missile still flying, in no set order
+    int flyingcellx(int) const;
+    int flyingcelly(int) const;
+
+
+  protected:
+
+    void retire(int, int, int);
+
+    // Every missile fired. The position is only kept up to date once
+    // the missile has landed; until then it's in the packed arrays.
+    struct Record {
+      double x, y;
+      int outcome;
+      int hit;
+      int steps;
+      int slot;                  // Position in the packed arrays, -1 once landed
+    };
+
+    const Layout * layout;
+    uint32_t generation;         // The layout's generation the missiles were fired in
+    int source;                  // ForceSource, picked when the first missile in flight was fired
+
+    Pool<Record> missiles;
+    std::vector<Handle> fired;   // In the order they were fired
+
+    // The missiles still flying, packed
+    std::vector<double> px, py;
+    std::vector<double> pvx, pvy;
+    std::vector<double> ox, oy;  // Where each was before this step, for swept collision
+    std::vector<double> ax, ay;  // Force per unit mass this step
+    std::vector<int> psteps;
+    std::vector<Handle> id;      // The missile in each slot
+
+};
+
+#endif
@@ -0,0 +1,157 @@
+#include<deque>
+#include"Scheduler.h"
+
+using namespace std;
+
+// A worker's task queue. The owner pops from the back, thieves
+// take from the front, so they rarely contend for the same end.
+struct TaskQueue {
+  mutex lock;
+  deque<int> tasks;
+
+  bool pop(int * task) {
+    lock_guard<mutex> guard(lock);
+    if (tasks.empty())
+      return false;
+    *task = tasks.back();
+    tasks.pop_back();
+    return true;
+  }
+
+  bool steal(int * task) {
+    lock_guard<mutex> guard(lock);
+    if (tasks.empty())
+      return false;
+    *task = tasks.front();
+    tasks.pop_front();
+    return true;
+  }
+};
+
+namespace {
+
+void worker(int self, vector<TaskQueue *> & queues, const function<void(int)> & run) {
+  int n = queues.size();
+  int task;
+  for (;;) {
+    if (queues[self]->pop(&task)) {
+      run(task);
+      continue;
+    }
+
+    // Own queue is empty; look for work elsewhere, starting with
+    // the next worker over so thieves spread out
+    bool stole = false;
+    for (int k = 1; k < n && !stole; ++k) {
+      stole = queues[(self + k) % n]->steal(&task);
+    }
+    if (!stole)
+      return;           // Tasks never spawn more tasks, so empty everywhere means done
+    run(task);
+  }
+}
+
+}
+
+int corecount() {
+  int n = thread::hardware_concurrency();
+  return (n > 0 ? n : 1);
+}
+
+void runtasks(int ntasks, int nthreads, const function<void(int)> & run) {
+  if (nthreads <= 0)
+    nthreads = corecount();
+  if (nthreads > ntasks)
+    nthreads = ntasks;
+  TaskPool pool(nthreads > 0 ? nthreads : 1);
+  pool.run(ntasks, run);
+}
+
+TaskPool::TaskPool(int nthreads) {
+  if (nthreads <= 0)
+    nthreads = corecount();
+  this->job = NULL;
+  this->batch = 0;
+  this->busy = 0;
+  this->quitting = false;
+  for (int w = 0; w < nthreads; ++w) {
+    this->queues.push_back(new TaskQueue);
+  }
+  for (int w = 1; w < nthreads; ++w) {
+    this->threads.push_back(thread(&TaskPool::serve, this, w));
+  }
+}
+
+TaskPool::~TaskPool() {
+  {
+    lock_guard<mutex> guard(this->lock);
+    this->quitting = true;
+  }
+  this->wake.notify_all();
+  for (size_t w = 0; w < this->threads.size(); ++w) {
+    this->threads[w].join();
+  }
+  for (size_t w = 0; w < this->queues.size(); ++w) {
+    delete this->queues[w];
+  }
+}
+
+int TaskPool::size() const {
+  return this->queues.size();
+}
+
+// A helper thread: works on each batch as it comes, then sleeps
+void TaskPool::serve(int self) {
+  uint64_t seen = 0;
+  unique_lock<mutex> guard(this->lock);
+  for (;;) {
+    while (!this->quitting && this->batch == seen) {
+      this->wake.wait(guard);
+    }
+    if (this->quitting)
+      return;
+    seen = this->batch;
+    const function<void(int)> & run = *this->job;
+    guard.unlock();
+    worker(self, this->queues, run);
+    guard.lock();
+    if (--this->busy == 0)
+      this->finished.notify_one();
+  }
+}
+
+void TaskPool::run(int ntasks, const function<void(int)> & run) {
+  if (this->threads.empty()) {
+    for (int t = 0; t < ntasks; ++t) {
+      run(t);
+    }
+    return;
+  }
+
+  // Deal each thread a contiguous block. Blocks are pushed in
+  // reverse so the owner works through them in order.
+  int nthreads = this->queues.size();
+  for (int w = 0; w < nthreads; ++w) {
+    int first = (long)ntasks * w / nthreads;
+    int last = (long)ntasks * (w + 1) / nthreads;
+    lock_guard<mutex> guard(this->queues[w]->lock);
+    for (int t = last - 1; t >= first; --t) {
+      this->queues[w]->tasks.push_back(t);
+    }
+  }
+
+  {
+    lock_guard<mutex> guard(this->lock);
+    this->job = &run;
+    this->busy = this->threads.size();
+    ++this->batch;
+  }
+  this->wake.notify_all();
+  worker(0, this->queues, run);      // The calling thread works too
+
+  // A helper can still be in its last task after the queues run dry
+  unique_lock<mutex> guard(this->lock);
+  while (this->busy > 0) {
+    this->finished.wait(guard);
+  }
+}
@@ -0,0 +1,55 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <stdint.h>
+
+struct TaskQueue;
+
+// Runs tasks 0 .. ntasks - 1 on nthreads threads with work
+// stealing. Each thread starts with a contiguous block of tasks and
+// works from the back of its own queue; a thread that runs dry
+// steals from the front of another thread's queue, so slow tasks
+// don't leave the other cores idle. Returns when every task is done.
+// nthreads <= 0 uses one thread per core.
+void runtasks(int, int, const std::function<void(int)> &);
+
+// The threads runtasks uses, kept between calls for callers that run
+// many small batches. run() works as runtasks, with the calling
+// thread as one of the nthreads.
+class TaskPool {
+
+
+  public:
+
+    TaskPool(int);               // nthreads <= 0 uses one per core
+    ~TaskPool();
+
+    void run(int, const std::function<void(int)> &);
+    int size() const;
+
+
+  protected:
+
+    void serve(int);
+
+    std::vector<TaskQueue *> queues;   // One per thread, the caller's first
+    std::vector<std::thread> threads;
+    std::mutex lock;
+    std::condition_variable wake;      // A batch is ready, or the pool is closing
+    std::condition_variable finished;  // The last helper is done with a batch
+    const std::function<void(int)> * job;
+    uint64_t batch;                    // Batches started
+    int busy;                          // Helpers still on this batch
+    bool quitting;
+
+};
+
+// Number of threads runtasks uses for nthreads <= 0
+int corecount();
+
+#endif
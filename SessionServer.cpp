@@ -0,0 +1,414 @@
+#include<cstring>
+#include<cerrno>
+#include<cmath>
+#include<atomic>
+#include<mutex>
+#include<condition_variable>
+#include<thread>
+#include<deque>
+#include<unistd.h>
+#include<fcntl.h>
+#include<sys/epoll.h>
+#include<sys/eventfd.h>
+#include<sys/socket.h>
+#include"SessionServer.h"
+#include"Match.h"
+#include"Net.h"
+#include"Pool.h"
+
+// Room for the hello and a couple of results a slow reader hasn't
+// taken yet. A player further behind than that is dropped.
+static const int OUTBUF = sizeof(NetHello) + 2 * sizeof(TurnResult);
+
+// One game. Players are sides 0 and 1, as in the game.
+struct Session {
+  int fd[2];
+  MatchState state;
+  bool busy;                        // A turn is with the workers
+  bool closing;                     // Over; closes once the last result is sent
+  bool writing[2];                  // Waiting for the socket to take more
+  int inlen[2];
+  int outlen[2];
+  char in[2][sizeof(NetTurn)];      // Turn being read
+  char out[2][OUTBUF];              // Bytes the socket wouldn't take yet
+};
+
+// A game for a shard to start
+struct NewGame {
+  int fd[2];
+  uint64_t seed;
+};
+
+// A turn to play, and the same turn played
+struct Job {
+  Handle session;
+  MatchState state;
+  NetTurn turn;
+};
+
+struct Done {
+  Handle session;
+  MatchState state;
+  TurnResult result;
+};
+
+struct Shard {
+  const ReplayHeader * game;
+  int epfd;
+  int wakefd;                       // eventfd: new games or finished turns are waiting
+  Pool<Session> sessions;
+
+  std::mutex lock;                  // Guards incoming and done
+  std::vector<NewGame> incoming;
+  std::vector<Done> done;
+
+  std::mutex joblock;               // Guards jobs and stopping
+  std::condition_variable jobready;
+  std::deque<Job> jobs;
+  bool stopping;
+
+  std::thread loop;
+  std::vector<std::thread> workers;
+  std::atomic<long> active, matches, turns;
+};
+
+static const uint64_t WAKE = ~(uint64_t)0;
+
+// epoll carries which session and side a socket belongs to, with the
+// session's generation, so events for a game that has just ended are
+// recognised and dropped
+static uint64_t tag(Handle h, int side) {
+  return ((uint64_t)h.generation << 32) | ((uint64_t)h.index << 1) | side;
+}
+
+static void wake(int fd) {
+  uint64_t one = 1;
+  ssize_t n = write(fd, &one, sizeof(one));
+  (void)n;
+}
+
+static void watch(Shard * shard, Handle h, int side, bool writable) {
+  Session * s = shard->sessions.get(h);
+  epoll_event ev;
+  ev.events = EPOLLIN | (writable ? EPOLLOUT : 0);
+  ev.data.u64 = tag(h, side);
+  epoll_ctl(shard->epfd, EPOLL_CTL_MOD, s->fd[side], &ev);
+}
+
+static void endsession(Shard * shard, Handle h) {
+  Session * s = shard->sessions.get(h);
+  close(s->fd[0]);                  // Also takes them out of the epoll set
+  close(s->fd[1]);
+  shard->sessions.destroy(h);
+  --shard->active;
+  ++shard->matches;
+}
+
+// Sends whatever is queued for one side. Returns false if the socket
+// has failed.
+static bool flush(Shard * shard, Handle h, int side) {
+  Session * s = shard->sessions.get(h);
+  int sent = 0;
+  while (sent < s->outlen[side]) {
+    ssize_t n = send(s->fd[side], s->out[side] + sent, s->outlen[side] - sent, MSG_NOSIGNAL);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+      break;
+    if (n <= 0)
+      return false;
+    sent += n;
+  }
+  memmove(s->out[side], s->out[side] + sent, s->outlen[side] - sent);
+  s->outlen[side] -= sent;
+  if (s->writing[side] != (s->outlen[side] > 0)) {
+    s->writing[side] = !s->writing[side];
+    watch(shard, h, side, s->writing[side]);
+  }
+  return true;
+}
+
+static bool queue(Shard * shard, Handle h, int side, const void * data, int n) {
+  Session * s = shard->sessions.get(h);
+  if (s->outlen[side] + n > OUTBUF)
+    return false;
+  memcpy(s->out[side] + s->outlen[side], data, n);
+  s->outlen[side] += n;
+  return flush(shard, h, side);
+}
+
+// Ends a game early, telling whoever is still there it's over
+static void abandon(Shard * shard, Handle h) {
+  Session * s = shard->sessions.get(h);
+  TurnResult quit;
+  memset(&quit, 0, sizeof(quit));
+  quit.action = REPLAY_QUIT;
+  quit.player = s->state.player;
+  quit.hit = -1;
+  quit.score[0] = s->state.score[0];
+  quit.score[1] = s->state.score[1];
+  for (int side = 0; side < 2; ++side)
+    send(s->fd[side], &quit, sizeof(quit), MSG_NOSIGNAL | MSG_DONTWAIT);
+  endsession(shard, h);
+}
+
+static void addsession(Shard * shard, const NewGame & g) {
+  Handle h = shard->sessions.create();
+  Session * s = shard->sessions.get(h);
+  s->fd[0] = g.fd[0];
+  s->fd[1] = g.fd[1];
+  s->state = startmatch(*shard->game);
+  s->state.seed = g.seed;
+  ++shard->active;
+  for (int side = 0; side < 2; ++side) {
+    epoll_event ev;
+    ev.events = EPOLLIN;
+    ev.data.u64 = tag(h, side);
+    epoll_ctl(shard->epfd, EPOLL_CTL_ADD, s->fd[side], &ev);
+  }
+  NetHello hello;
+  memset(&hello, 0, sizeof(hello));
+  memcpy(hello.magic, "BPNT", 4);
+  hello.version = NETVERSION;
+  hello.game = *shard->game;
+  hello.game.seed = g.seed;
+  for (int side = 0; side < 2; ++side) {
+    hello.player = side;
+    if (!queue(shard, h, side, &hello, sizeof(hello))) {
+      abandon(shard, h);
+      return;
+    }
+  }
+}
+
+// Reads what has arrived from one side. A whole turn from the player
+// whose turn it is goes to the workers; anything else ends the game.
+static void readable(Shard * shard, Handle h, int side) {
+  Session * s = shard->sessions.get(h);
+  ssize_t n = recv(s->fd[side], s->in[side] + s->inlen[side], sizeof(NetTurn) - s->inlen[side], 0);
+  if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+    return;
+  if (n <= 0 || s->closing) {
+    abandon(shard, h);
+    return;
+  }
+  s->inlen[side] += n;
+  if (s->inlen[side] < (int)sizeof(NetTurn))
+    return;
+  s->inlen[side] = 0;
+
+  Job job;
+  memcpy(&job.turn, s->in[side], sizeof(NetTurn));
+  bool valid = (job.turn.action == REPLAY_QUIT || job.turn.action == REPLAY_NEW || job.turn.action == REPLAY_FIRE)
+               && std::isfinite(job.turn.speed) && std::isfinite(job.turn.angle);
+  if (!valid || side != s->state.player || s->busy) {
+    abandon(shard, h);
+    return;
+  }
+  s->busy = true;
+  job.session = h;
+  job.state = s->state;
+  {
+    std::lock_guard<std::mutex> hold(shard->joblock);
+    shard->jobs.push_back(job);
+  }
+  shard->jobready.notify_one();
+}
+
+static void finished(Shard * shard, const Done & d) {
+  Session * s = shard->sessions.get(d.session);
+  if (!s)
+    return;                         // The game ended while the turn was being played
+  s->state = d.state;
+  s->busy = false;
+  ++shard->turns;
+  for (int side = 0; side < 2; ++side) {
+    if (!queue(shard, d.session, side, &d.result, sizeof(d.result))) {
+      abandon(shard, d.session);
+      return;
+    }
+  }
+  if (d.result.action == REPLAY_QUIT) {
+    s->closing = true;
+    if (s->outlen[0] == 0 && s->outlen[1] == 0)
+      endsession(shard, d.session);
+  }
+}
+
+static void eventloop(Shard * shard) {
+  epoll_event events[256];
+  std::vector<NewGame> incoming;
+  std::vector<Done> done;
+  while (true) {
+    int n = epoll_wait(shard->epfd, events, 256, -1);
+    if (n < 0 && errno != EINTR)
+      break;
+    for (int e = 0; e < n; ++e) {
+      uint64_t t = events[e].data.u64;
+      if (t == WAKE) {
+        uint64_t count;
+        ssize_t got = read(shard->wakefd, &count, sizeof(count));
+        (void)got;
+        {
+          std::lock_guard<std::mutex> hold(shard->lock);
+          incoming.swap(shard->incoming);       // Both keep their memory for next time
+          done.swap(shard->done);
+        }
+        {
+          std::lock_guard<std::mutex> hold(shard->joblock);
+          if (shard->stopping)
+            return;
+        }
+        for (size_t k = 0; k < incoming.size(); ++k)
+          addsession(shard, incoming[k]);
+        for (size_t k = 0; k < done.size(); ++k)
+          finished(shard, done[k]);
+        incoming.clear();
+        done.clear();
+        continue;
+      }
+      Handle h = {(uint32_t)(t >> 1) & 0x7fffffffu, (uint32_t)(t >> 32)};
+      int side = t & 1;
+      if (!shard->sessions.get(h))
+        continue;                   // Ended earlier in this batch
+      if (events[e].events & EPOLLOUT) {
+        if (!flush(shard, h, side)) {
+          abandon(shard, h);
+          continue;
+        }
+        Session * s = shard->sessions.get(h);
+        if (s->closing && s->outlen[0] == 0 && s->outlen[1] == 0) {
+          endsession(shard, h);
+          continue;
+        }
+      }
+      if (events[e].events & (EPOLLIN | EPOLLHUP | EPOLLERR))
+        readable(shard, h, side);
+    }
+  }
+}
+
+// Each worker keeps its own layout, rebuilt only when a turn is for a
+// game on different planets from the last one it played
+static void worker(Shard * shard) {
+  Layout layout;
+  replaysettings(*shard->game, layout);
+  Salvo salvo(layout);
+  while (true) {
+    Job job;
+    {
+      std::unique_lock<std::mutex> hold(shard->joblock);
+      shard->jobready.wait(hold, [&] { return shard->stopping || !shard->jobs.empty(); });
+      if (shard->stopping)
+        return;
+      job = shard->jobs.front();
+      shard->jobs.pop_front();
+    }
+    Done d;
+    d.session = job.session;
+    d.state = job.state;
+    d.result = playturn(d.state, *shard->game, layout, salvo, job.turn.action, job.turn.speed, job.turn.angle);
+    {
+      std::lock_guard<std::mutex> hold(shard->lock);
+      shard->done.push_back(d);
+    }
+    wake(shard->wakefd);
+  }
+}
+
+SessionServer::SessionServer(const ReplayHeader & h, int nshards, int nworkers) {
+  this->game = h;
+  this->listener = -1;
+  for (int k = 0; k < nshards; ++k) {
+    Shard * shard = new Shard;
+    shard->game = &this->game;
+    shard->epfd = epoll_create1(0);
+    shard->wakefd = eventfd(0, EFD_NONBLOCK);
+    shard->stopping = false;
+    shard->active = 0;
+    shard->matches = 0;
+    shard->turns = 0;
+    epoll_event ev;
+    ev.events = EPOLLIN;
+    ev.data.u64 = WAKE;
+    epoll_ctl(shard->epfd, EPOLL_CTL_ADD, shard->wakefd, &ev);
+    shard->loop = std::thread(eventloop, shard);
+    for (int w = 0; w < nworkers; ++w)
+      shard->workers.push_back(std::thread(worker, shard));
+    this->shards.push_back(shard);
+  }
+}
+
+SessionServer::~SessionServer() {
+  this->stop();
+}
+
+bool SessionServer::listen(int port) {
+  this->listener = netlisten(port);
+  return this->listener >= 0;
+}
+
+void SessionServer::run() {
+  int waiting = -1;                 // First of the next pair
+  uint64_t next = 0;
+  while (true) {
+    int fd = netaccept(this->listener);
+    if (fd < 0) {
+      if (errno == EINTR || errno == ECONNABORTED || errno == EMFILE || errno == ENFILE)
+        continue;
+      break;                        // interrupt()
+    }
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    if (waiting < 0) {
+      waiting = fd;
+      continue;
+    }
+    NewGame g = {{waiting, fd}, this->game.seed + next * 1000};   // Each game on its own planets
+    Shard * shard = this->shards[next++ % this->shards.size()];
+    {
+      std::lock_guard<std::mutex> hold(shard->lock);
+      shard->incoming.push_back(g);
+    }
+    wake(shard->wakefd);
+    waiting = -1;
+  }
+  if (waiting >= 0)
+    close(waiting);
+}
+
+void SessionServer::interrupt() {
+  if (this->listener >= 0)
+    shutdown(this->listener, SHUT_RDWR);
+}
+
+void SessionServer::stop() {
+  for (size_t k = 0; k < this->shards.size(); ++k) {
+    Shard * shard = this->shards[k];
+    {
+      std::lock_guard<std::mutex> hold(shard->joblock);
+      shard->stopping = true;
+    }
+    shard->jobready.notify_all();
+    wake(shard->wakefd);
+    shard->loop.join();
+    for (size_t w = 0; w < shard->workers.size(); ++w)
+      shard->workers[w].join();
+    close(shard->epfd);
+    close(shard->wakefd);
+    delete shard;                   // Open games' sockets go when the process does
+  }
+  this->shards.clear();
+  if (this->listener >= 0)
+    close(this->listener);
+  this->listener = -1;
+}
+
+ServerStats SessionServer::getstats() const {
+  ServerStats stats = {0, 0, 0};
+  for (size_t k = 0; k < this->shards.size(); ++k) {
+    stats.active += this->shards[k]->active;
+    stats.matches += this->shards[k]->matches;
+    stats.turns += this->shards[k]->turns;
+  }
+  return stats;
+}
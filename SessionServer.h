@@ -0,0 +1,62 @@
+#ifndef SESSIONSERVER_H
+#define SESSIONSERVER_H
+
+#include <vector>
+#include "Replay.h"
+
+struct Shard;
+
+struct ServerStats {
+  long active;          // Games being played
+  long matches;         // Games finished
+  long turns;           // Turns played, over every game
+};
+
+// Hosts any number of two-player games in one process, all with the
+// same settings but each on its own seed, speaking the protocol in
+// Net.h, so "battleplanets --connect" plays on it just as on bpserver.
+//
+// Players are paired in the order they connect, and each game is
+// handed to one of several shards, round robin, for good. A shard is
+// a thread running an epoll loop over its own games' sockets, and a
+// few workers that fly the shots, so a long shot doesn't hold up the
+// other games' I/O. Shards share nothing but the settings: each has
+// its own games, queues and locks, so they don't contend. A game is
+// kept as its sockets, half-read messages and MatchState; workers
+// rebuild the planets from the seed when a shot needs them.
+class SessionServer {
+
+
+  public:
+
+    // Settings, shards and workers per shard. The settings should
+    // have a maxsteps, so a missile caught in an orbit can't hold a
+    // worker; they go to every player in the hello, so the players'
+    // screens stop each shot where the server did.
+    SessionServer(const ReplayHeader &, int, int);
+    ~SessionServer();
+
+    bool listen(int);       // Port; false if it can't be bound
+
+    // Accepts players until interrupt(). Call once, after listen.
+    void run();
+
+    // Makes run() return. Only shuts the listening socket, so it is
+    // safe in a signal handler.
+    void interrupt();
+
+    // Ends every game and returns once the threads have
+    void stop();
+
+    ServerStats getstats() const;
+
+
+  protected:
+
+    ReplayHeader game;
+    int listener;
+    std::vector<Shard *> shards;
+
+};
+
+#endif
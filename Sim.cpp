@@ -0,0 +1,371 @@
+#include<cmath>
+#include<vector>
+#include<climits>
+#include<algorithm>
+#include"Sim.h"
+#include"Profile.h"
+#include"Trajectory.h"
+
+using namespace std;
+
+Layout::Layout() {
+  this->nlines = 0;
+  this->ncols = 0;
+  this->seed = 0;
+  this->generation = 0;
+  this->forcelaw = FORCE_NEWTON;
+  this->integrator = INTEGRATE_EULER;
+  this->tolerance = 1e-6;
+  this->swept = false;
+  this->trajectory = NULL;
+}
+
+
+// Small, fast generator so a seed gives the same layout on every
+// machine. splitmix64, by Sebastiano Vigna.
+namespace {
+
+struct LayoutRandom {
+  uint64_t state;
+
+  uint64_t next() {
+    uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+  }
+
+  // Uniform in 0 .. n - 1
+  int below(int n) {
+    return (int)(((next() >> 32) * (uint64_t)n) >> 32);
+  }
+};
+
+}
+
+int planetcount(int nlines, int ncols) {
+  int64_t num = (int64_t)nlines * ncols / 700;
+  return (int)min(num, (int64_t)INT_MAX);
+}
+
+// Arranges the selected number of planets on the screen, at
+// pseudo-random locations. Ensures they do not overlap or
+// go off the edge of the screen.
+//
+// Candidates are thrown at random and kept if they clear every
+// planet already placed, Poisson-disk style. A grid over the field
+// means each candidate is only checked against its neighbours, and
+// each planet gets a fixed number of tries, so a crowded field ends
+// up with fewer planets instead of never finishing.
+//
+// The two players' planets come first and are always placed, however
+// few planets are asked for. If the second can't be put anywhere at
+// random, both go to fixed spots a quarter of the way in from each
+// side. A field without room for that gets no planets at all.
+LayoutStats arrangeplanets(Layout & layout, int num, int nlines, int ncols, uint64_t seed) {
+  LayoutRandom rng = {seed};
+  int minlines = 3;                           // Bounaries take into account the UI elements
+  int maxlines = nlines - 4;
+  int linesrange = maxlines - minlines;
+  int mincols = 0;
+  int maxcols = ncols;
+  int colsrange = maxcols - mincols;
+  int sizes[5] = {3, 4, 5, 6, 9};
+  const int maxsize = 9;
+
+  // Occupancy grid in (x / 2, y). A cell is as wide as the largest
+  // radius, so two planets close enough to touch are at most two
+  // cells apart.
+  double cellsize = maxsize / 2.0;
+  int gridw = (int)(colsrange / 2 / cellsize) + 1;
+  int gridh = (int)(linesrange / cellsize) + 1;
+  vector<int> cellhead(gridw > 0 && gridh > 0 ? gridw * gridh : 1, -1);
+  vector<int> cellnext;           // Next planet in the same cell
+
+  vector<int> s;                  // Stores the sizes of the bodes;
+  vector<double> x, y;            // Stores the locations of the bodies;
+  s.reserve(num);
+  x.reserve(num);
+  y.reserve(num);
+  int attempts = 0;
+
+  // Adds a planet at (px, py) if it doesn't overlap any placed so far
+  auto place = [&](double px, double py, int size) {
+    int ci = (int)((px - mincols) / 2 / cellsize);
+    int cj = (int)((py - minlines) / cellsize);
+    for (int j = cj - 2; j <= cj + 2; ++j) {
+      for (int k = ci - 2; k <= ci + 2; ++k) {
+        if (j < 0 || k < 0 || j >= gridh || k >= gridw)
+          continue;
+        for (int o = cellhead[j * gridw + k]; o >= 0; o = cellnext[o]) {
+          double dx = (px - x[o]) / 2;      // Halve the x number to get distance
+          double dy = py - y[o];
+          double mindist = (double)size / 2 + (double)s[o] / 2;
+          if (dx * dx + dy * dy < mindist * mindist)
+            return false;
+        }
+      }
+    }
+    int c = cj * gridw + ci;
+    cellnext.push_back(cellhead[c]);
+    cellhead[c] = x.size();
+    s.push_back(size);
+    x.push_back(px);
+    y.push_back(py);
+    return true;
+  };
+
+  // The fixed spots for the players' planets must be on the field and
+  // clear of each other
+  const int playersize = 9;
+  bool roomforplayers = (colsrange / 4 >= playersize && linesrange - playersize > 0);
+
+  for (int i = 0; (i < num || i < 2) && roomforplayers; ++i) {
+    int size = (i < 2 ? playersize : sizes[rng.below(5)]);    // There must be at least two planets of size 9
+    int tries = (i < 2 ? PLAYERTRIES : PLANETTRIES);
+    if (colsrange - 2 * size <= 0 || linesrange - size <= 0)
+      continue;                   // Doesn't fit on the field at all
+
+    bool placed = false;
+    for (int t = 0; t < tries && !placed; ++t) {
+      ++attempts;
+      // x values are double y values for the same distance, hence the differing algorithms
+      double px = rng.below(colsrange - 2 * size) + (mincols + size);
+      double py = rng.below(linesrange - size) + (minlines + size / 2);
+      placed = place(px, py, size);
+    }
+    if (!placed && i == 1) {
+      // The first player's planet is in the way of every try; start
+      // again with both players at their fixed spots
+      cellhead.assign(cellhead.size(), -1);
+      cellnext.clear();
+      s.clear();
+      x.clear();
+      y.clear();
+      double py = minlines + linesrange / 2;
+      place(mincols + colsrange / 4, py, playersize);
+      place(mincols + colsrange - colsrange / 4, py, playersize);
+    }
+  }
+
+  // Store the planets
+  BodyStore & planets = layout.planets;
+  planets.clear();
+  planets.reserve(s.size());
+  double area = 0;
+  for (size_t i = 0; i < s.size(); ++i) {
+    planets.add(x[i], y[i], s[i]);
+    area += PI * s[i] * s[i] / 4;
+  }
+  layout.nlines = nlines;
+  layout.ncols = ncols;
+  layout.seed = seed;
+  ++layout.generation;
+  layout.hash.build(planets);         // Index the new layout for collision checks
+  layout.tree.build(planets);         // The planets never move, so the tree is built once per layout
+
+  LayoutStats stats;
+  stats.requested = num;
+  stats.placed = s.size();
+  stats.attempts = attempts;
+  stats.fill = (colsrange > 0 && linesrange > 0 ? area / (colsrange / 2.0 * linesrange) : 0);
+  return stats;
+}
+
+int checkcollision(const Missile & proj, const Layout & layout) {  // Checks whether the projectile is within a certain distance of the planet center
+  // Only the bodies in the grid cells around the missile are tested,
+  // so the cost doesn't grow with the size of the field.
+  // Returns the index of the body collided with, or -1 if there hasn't been a collision.
+  PROFILE_SCOPE(PROF_COLLIDE);
+  return layout.hash.query(proj.getx(), proj.gety());
+}
+
+// Returns true if the missile goes out of bounds
+bool checkSides(const Missile & Projectile, int cols, int lines) {
+  int mx = Projectile.getcellx();
+  int my = Projectile.getcelly();
+  if ((mx < (cols-2)) && (mx >1)) {
+    if ((my < (lines-3)) && (my > 2)) {
+      return false;
+    }
+    else {
+      return true;
+    }
+  }
+  else {
+    return true;
+  }
+}
+
+// The field checkSides allows is 2 <= x < cols-2, 3 <= y < lines-3.
+// Finds the first point along the step where the missile is outside it.
+bool sweepsides(double x0, double y0, double x1, double y1, int cols, int lines, double * t) {
+  double lo[2] = {2, 3};
+  double hi[2] = {(double)(cols - 2), (double)(lines - 3)};
+  double p0[2] = {x0, y0};
+  double p1[2] = {x1, y1};
+  *t = 1;
+  bool out = false;
+  for (int a = 0; a < 2; ++a) {
+    double ta;
+    if (p0[a] < lo[a] || p0[a] >= hi[a])
+      ta = 0;                                         // Started out of bounds
+    else if (p1[a] < lo[a])
+      ta = (lo[a] - p0[a]) / (p1[a] - p0[a]);
+    else if (p1[a] >= hi[a])
+      ta = (hi[a] - p0[a]) / (p1[a] - p0[a]);
+    else
+      continue;
+    if (ta < *t || !out)
+      *t = ta;
+    out = true;
+  }
+  return out;
+}
+
+
+Shot::Shot(const Layout & field, double speed, double angle, int shooter)
+  : missile(field.planets.getx(shooter), field.planets.gety(shooter), speed, angle, LAUNCHRADIUS) {
+  this->layout = &field;
+  this->motion = motionstate(this->missile.getx(), this->missile.gety(), this->missile.getvx(), this->missile.getvy());
+  this->source = forcesource(field);    // Large fields use the Barnes-Hut approximation, or the grid once it's baked
+  this->outcome = SHOT_FLYING;
+  this->hit = -1;
+  this->contact.body = -1;
+  this->contact.t = 0;
+  this->contact.x = this->missile.getx();
+  this->contact.y = this->missile.gety();
+  this->steps = 0;
+  this->shotid = (field.trajectory ? field.trajectory->newshot() : 0);
+}
+
+// Moves the missile one frame: force, velocity, position, then the
+// collision and edge checks
+int Shot::step() {
+  if (this->outcome != SHOT_FLYING)
+    return this->outcome;
+
+  const Layout & field = *this->layout;
+  double x0 = this->missile.getx(), y0 = this->missile.gety();
+  double missileforce[2] = {0, 0};
+  if (field.integrator == INTEGRATE_EULER) {
+    if (this->source == SOURCE_GRID)
+      this->missile.getforce(field.grid, missileforce);          // Constant time once the field has been baked
+    else if (this->source == SOURCE_TREE)
+      this->missile.getforce(field.tree, missileforce, field.forcelaw);
+    else
+      this->missile.getforce(field.planets, missileforce, field.forcelaw);   // Calculates the force from all the other bodies' gravity
+    this->missile.setvelocity(missileforce);                      // Sets velocity using dv = F/m dt
+    this->missile.movebody();                                     // Moves the body according to its velocity
+    ++this->motion.evals;
+  }
+  else {
+    MotionState & m = this->motion;
+    if (field.trajectory) {
+      fieldaccel(field, this->source, x0, y0, missileforce);     // Only worked out for the record
+      missileforce[0] *= this->missile.getmass();
+      missileforce[1] *= this->missile.getmass();
+    }
+    integrateframe(field, this->source, field.integrator, field.tolerance, m);
+    this->missile.setstate(m.x, m.y, m.vx, m.vy);
+  }
+  ++this->steps;
+
+  if (field.swept) {
+    // Tests the segment travelled this step, so a fast missile can't
+    // jump over a planet or a corner of the field between frames
+    double x1 = this->missile.getx(), y1 = this->missile.gety();
+    double tside;
+    bool hitbody, offside;
+    {
+      PROFILE_SCOPE(PROF_COLLIDE);
+      hitbody = field.hash.sweep(x0, y0, x1, y1, &this->contact);
+      offside = sweepsides(x0, y0, x1, y1, field.ncols, field.nlines, &tside);
+    }
+    if (hitbody && (!offside || this->contact.t <= tside)) {
+      this->hit = this->contact.body;
+      this->outcome = SHOT_HIT;
+      this->missile.setstate(this->contact.x, this->contact.y, this->missile.getvx(), this->missile.getvy());
+    }
+    else if (offside) {
+      this->contact.body = -1;
+      this->contact.t = tside;
+      this->contact.x = x0 + tside * (x1 - x0);
+      this->contact.y = y0 + tside * (y1 - y0);
+      this->outcome = SHOT_OFFSCREEN;
+    }
+  }
+  else {
+    this->hit = checkcollision(this->missile, field);
+    this->contact.body = this->hit;
+    this->contact.t = 1;
+    this->contact.x = this->missile.getx();
+    this->contact.y = this->missile.gety();
+    if (this->hit >= 0)
+      this->outcome = SHOT_HIT;
+    else if (checkSides(this->missile, field.ncols, field.nlines))
+      this->outcome = SHOT_OFFSCREEN;
+  }
+
+  if (field.trajectory)
+    this->trace(missileforce);
+  return this->outcome;
+}
+
+const Missile & Shot::getmissile() const {
+  return this->missile;
+}
+
+int Shot::getoutcome() const {
+  return this->outcome;
+}
+
+int Shot::gethit() const {
+  return this->hit;
+}
+
+// Sends this step to the layout's trajectory sink
+void Shot::trace(const double * force) {
+  TrajectoryRecord r;
+  r.shot = this->shotid;
+  r.step = this->steps;
+  r.x = this->missile.getx();
+  r.y = this->missile.gety();
+  r.vx = this->missile.getvx();
+  r.vy = this->missile.getvy();
+  r.fx = force[0];
+  r.fy = force[1];
+  double dist;
+  r.nearest = this->layout->hash.nearest(r.x, r.y, &dist);
+  r.distance = dist;
+  this->layout->trajectory->add(r);
+}
+
+const Contact & Shot::getcontact() const {
+  return this->contact;
+}
+
+int Shot::getsteps() const {
+  return this->steps;
+}
+
+long Shot::getevals() const {
+  return this->motion.evals;
+}
+
+
+ShotResult simulate_shot(const Layout & layout, double speed, double angle, int shooter, int maxsteps) {
+  Shot shot(layout, speed, angle, shooter);
+  int outcome = SHOT_FLYING;
+  while (outcome == SHOT_FLYING && shot.getsteps() < maxsteps) {
+    outcome = shot.step();
+  }
+
+  ShotResult result;
+  result.outcome = (outcome == SHOT_FLYING ? SHOT_TIMEOUT : outcome);
+  result.hit = shot.gethit();
+  result.steps = shot.getsteps();
+  result.evals = shot.getevals();
+  result.contact = shot.getcontact();
+  return result;
+}
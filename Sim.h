@@ -0,0 +1,140 @@
+#ifndef SIM_H
+#define SIM_H
+
+#include <stdint.h>
+#include "Body.h"
+#include "BodyStore.h"
+#include "SpatialHash.h"
+#include "QuadTree.h"
+#include "FieldGrid.h"
+#include "Integrator.h"
+#include "Physics.h"
+
+class TrajectorySink;
+
+// The renderer-free simulation core. Everything here works without
+// a terminal, so shots can be evaluated in batch as fast as the
+// physics allows. The ncurses game in main.cpp is a front end that
+// draws a Shot between steps.
+
+// Everything the physics needs to know about one planet layout.
+// Planets 0 and 1 are the players' planets.
+struct Layout {
+  Layout();
+
+  BodyStore planets;
+  SpatialHash hash;     // Collision index, rebuilt by arrangeplanets
+  QuadTree tree;        // Barnes-Hut tree, rebuilt by arrangeplanets
+  FieldGrid grid;       // Optional baked field, used once it is ready
+  int nlines;           // Size of the playing field, in screen cells
+  int ncols;
+  uint64_t seed;        // Seed arrangeplanets built it from
+  uint32_t generation;  // Bumped by every arrangeplanets, so body indexes kept from an older layout can be told apart
+  int forcelaw;         // ForceLawKind the planets pull with
+  int integrator;       // IntegratorKind used to move missiles
+  double tolerance;     // Error tolerance for INTEGRATE_RK45
+  bool swept;           // Test the whole path of each step for hits, not just its end
+  TrajectorySink * trajectory;   // Gets a record of every step of every shot, if set
+};
+
+// How well arrangeplanets filled the field
+struct LayoutStats {
+  int requested;        // Planets asked for
+  int placed;           // Planets that fit
+  int attempts;         // Candidate positions tried
+  double fill;          // Fraction of the field's area covered by planets
+};
+
+// Ways a shot can end
+enum ShotOutcome {
+  SHOT_FLYING,        // Still in the air
+  SHOT_HIT,           // Collided with a body
+  SHOT_OFFSCREEN,     // Left the playing field
+  SHOT_TIMEOUT        // Ran out of steps, e.g. caught in an orbit
+};
+
+struct ShotResult {
+  int outcome;        // One of ShotOutcome
+  int hit;            // Index of the body hit, -1 if none
+  int steps;          // Number of physics steps taken
+  long evals;         // Force evaluations it took
+  Contact contact;    // Where the shot ended, and how far into its last step
+};
+
+// Missiles are launched from this far out from the center of the
+// player's planet, so they start clear of it
+const double LAUNCHRADIUS = 9;
+
+// Steps simulate_shot allows before giving up on a shot
+const int MAXSTEPS = 5000;
+
+// Tries each planet this many times before leaving it out. The
+// players' planets get far more tries, as the game needs both.
+const int PLANETTRIES = 30;
+const int PLAYERTRIES = 10000;
+
+// Creates a random arrangement of up to num planets for an nlines
+// by ncols field from the given seed, and rebuilds the layout's
+// indexes. The same seed and size always give the same layout.
+// Takes bounded time however crowded the field is. The players'
+// planets are always placed if the field has room for them side by
+// side; if it doesn't, it gets no planets, and the game can't be
+// played on it.
+LayoutStats arrangeplanets(Layout &, int, int, int, uint64_t);
+
+// Planets the game puts on an nlines by ncols field, one per 700
+// cells. Worked out in 64 bits so a big field can't overflow it.
+int planetcount(int, int);
+
+// Returns the index of the body the missile is inside, or -1
+int checkcollision(const Missile &, const Layout &);
+
+// Returns true if the missile has reached the edge of the field
+bool checkSides(const Missile &, int, int);
+
+// Continuous version of checkSides for a missile moving from (x0, y0)
+// to (x1, y1). Returns true if it leaves the field on the way, and
+// sets t to the fraction of the step at which it does.
+bool sweepsides(double, double, double, double, int, int, double *);
+
+// One missile in flight. Each call to step() advances it by one
+// frame and reports how the shot stands.
+class Shot {
+
+
+  public:
+
+    // Fire from planet "shooter" at the given speed (0 - 10) and
+    // angle (degrees)
+    Shot(const Layout &, double, double, int);
+
+    int step();
+
+    const Missile & getmissile() const;
+    int getoutcome() const;
+    int gethit() const;
+    const Contact & getcontact() const;
+    int getsteps() const;
+    long getevals() const;
+
+
+  protected:
+
+    void trace(const double *);
+
+    const Layout * layout;
+    Missile missile;
+    MotionState motion;   // Integrator state, for anything but INTEGRATE_EULER
+    int source;           // ForceSource, picked when fired
+    int outcome;
+    int hit;
+    Contact contact;      // Where the last step ended or struck something
+    int steps;
+    uint32_t shotid;      // Number the trajectory sink gave this shot
+
+};
+
+// Fires a shot without drawing it and runs it to the end
+ShotResult simulate_shot(const Layout &, double, double, int = 0, int = MAXSTEPS);
+
+#endif
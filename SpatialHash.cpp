@@ -0,0 +1,241 @@
+#include<cmath>
+#include"SpatialHash.h"
+#include"BodyStore.h"
+#include"Physics.h"
+
+// Like the collision check, the grid works in (x / ASPECT, y) since
+// chars are taller than they are wide.
+
+SpatialHash::SpatialHash() {
+  this->clear();
+}
+
+void SpatialHash::clear() {
+  this->cellsize = 1;
+  this->originx = 0;
+  this->originy = 0;
+  this->ncellx = 0;
+  this->ncelly = 0;
+  this->cellstart.clear();
+  this->index.clear();
+  this->hx.clear();
+  this->hy.clear();
+  this->rad2.clear();
+}
+
+// Finds the cell holding (px, py), clamped to the grid. Returns
+// its position in cellstart.
+int SpatialHash::cellof(double px, double py, int * ci, int * cj) const {
+  int i = floor((px - this->originx) / this->cellsize);
+  int j = floor((py - this->originy) / this->cellsize);
+  i = (i < 0 ? 0 : (i >= this->ncellx ? this->ncellx - 1 : i));
+  j = (j < 0 ? 0 : (j >= this->ncelly ? this->ncelly - 1 : j));
+  *ci = i;
+  *cj = j;
+  return j * this->ncellx + i;
+}
+
+void SpatialHash::build(const BodyStore & bodies) {
+  this->clear();
+  int n = bodies.count();
+  if (n == 0)
+    return;
+
+  double maxrad = 0;
+  double minx = bodies.getx(0) / ASPECT, maxx = minx;
+  double miny = bodies.gety(0), maxy = miny;
+  for (int i = 0; i < n; ++i) {
+    maxrad = fmax(maxrad, bodies.getradius(i));
+    minx = fmin(minx, bodies.getx(i) / ASPECT);
+    maxx = fmax(maxx, bodies.getx(i) / ASPECT);
+    miny = fmin(miny, bodies.gety(i));
+    maxy = fmax(maxy, bodies.gety(i));
+  }
+  this->cellsize = fmax(maxrad, 1.0);
+  this->originx = minx;
+  this->originy = miny;
+  this->ncellx = (int)((maxx - minx) / this->cellsize) + 1;
+  this->ncelly = (int)((maxy - miny) / this->cellsize) + 1;
+
+  // Counting sort of the bodies by cell. Bodies are visited in index
+  // order, so each cell's run stays sorted by index.
+  std::vector<int> cell(n);
+  this->cellstart.assign(this->ncellx * this->ncelly + 1, 0);
+  for (int i = 0; i < n; ++i) {
+    int ci, cj;
+    cell[i] = cellof(bodies.getx(i) / ASPECT, bodies.gety(i), &ci, &cj);
+    ++this->cellstart[cell[i] + 1];
+  }
+  for (size_t c = 1; c < this->cellstart.size(); ++c) {
+    this->cellstart[c] += this->cellstart[c - 1];
+  }
+
+  this->index.resize(n);
+  this->hx.resize(n);
+  this->hy.resize(n);
+  this->rad2.resize(n);
+  std::vector<int> fill(this->cellstart.begin(), this->cellstart.end() - 1);
+  for (int i = 0; i < n; ++i) {
+    int k = fill[cell[i]]++;
+    double r = bodies.getradius(i);
+    this->index[k] = i;
+    this->hx[k] = bodies.getx(i) / ASPECT;
+    this->hy[k] = bodies.gety(i);
+    this->rad2[k] = r * r;
+  }
+}
+
+int SpatialHash::query(double px, double py) const {
+  if (this->index.empty())
+    return -1;
+
+  double qx = px / ASPECT;
+  int ci, cj;
+  cellof(qx, py, &ci, &cj);
+
+  // A point well outside the grid can't be near any body
+  double gx = (qx - this->originx) / this->cellsize;
+  double gy = (py - this->originy) / this->cellsize;
+  if (gx < -1 || gy < -1 || gx > this->ncellx + 1 || gy > this->ncelly + 1)
+    return -1;
+
+  int hit = -1;
+  int i0 = (ci > 0 ? ci - 1 : 0), i1 = (ci + 1 < this->ncellx ? ci + 1 : ci);
+  int j0 = (cj > 0 ? cj - 1 : 0), j1 = (cj + 1 < this->ncelly ? cj + 1 : cj);
+  for (int j = j0; j <= j1; ++j) {
+    for (int i = i0; i <= i1; ++i) {
+      int c = j * this->ncellx + i;
+      for (int k = this->cellstart[c]; k < this->cellstart[c + 1]; ++k) {
+        double dx = qx - this->hx[k];
+        double dy = py - this->hy[k];
+        if (dx * dx + dy * dy < this->rad2[k] && (hit < 0 || this->index[k] < hit)) {
+          hit = this->index[k];
+        }
+      }
+    }
+  }
+  return hit;
+}
+
+bool SpatialHash::sweep(double x0, double y0, double x1, double y1, Contact * hit) const {
+  hit->body = -1;
+  hit->t = 1;
+  hit->x = x1;
+  hit->y = y1;
+  if (this->index.empty())
+    return false;
+
+  double ax = x0 / ASPECT, ay = y0;
+  double dx = (x1 - x0) / ASPECT, dy = y1 - y0;
+  double dd = dx * dx + dy * dy;
+
+  // Every cell the segment's bounding box touches, padded by one
+  // cell since a body can reach a cell's width out of its own cell
+  int i0, j0, i1, j1;
+  cellof(fmin(ax, ax + dx) - this->cellsize, fmin(ay, ay + dy) - this->cellsize, &i0, &j0);
+  cellof(fmax(ax, ax + dx) + this->cellsize, fmax(ay, ay + dy) + this->cellsize, &i1, &j1);
+
+  double best = 2;
+  for (int j = j0; j <= j1; ++j) {
+    for (int i = i0; i <= i1; ++i) {
+      int c = j * this->ncellx + i;
+      for (int k = this->cellstart[c]; k < this->cellstart[c + 1]; ++k) {
+        // Solve |a + t d - center|^2 = r^2 for the first t in [0, 1]
+        double fx = ax - this->hx[k];
+        double fy = ay - this->hy[k];
+        double cc = fx * fx + fy * fy - this->rad2[k];
+        double t;
+        if (cc < 0) {
+          t = 0;                     // Already inside at the start
+        }
+        else {
+          if (dd == 0)
+            continue;
+          double b = fx * dx + fy * dy;
+          double disc = b * b - dd * cc;
+          if (b >= 0 || disc < 0)
+            continue;                // Moving away, or the line misses
+          t = (-b - sqrt(disc)) / dd;
+          if (t > 1)
+            continue;
+        }
+        if (t < best || (t == best && this->index[k] < hit->body)) {
+          best = t;
+          hit->body = this->index[k];
+        }
+      }
+    }
+  }
+
+  if (hit->body < 0)
+    return false;
+  hit->t = best;
+  hit->x = x0 + best * (x1 - x0);
+  hit->y = y0 + best * (y1 - y0);
+  return true;
+}
+
+int SpatialHash::nearest(double px, double py, double * dist) const {
+  *dist = HUGE_VAL;
+  if (this->index.empty())
+    return -1;
+
+  double qx = px / ASPECT;
+  int ci, cj;
+  cellof(qx, py, &ci, &cj);
+
+  // Anything past ring r is at least r cells away, as the point sits
+  // in (or, off the grid, beyond) the center cell
+  int best = -1;
+  double best2 = HUGE_VAL;
+  int maxring = (this->ncellx > this->ncelly ? this->ncellx : this->ncelly);
+  for (int r = 0; r <= maxring; ++r) {
+    for (int j = cj - r; j <= cj + r; ++j) {
+      if (j < 0 || j >= this->ncelly)
+        continue;
+      bool edge = (j == cj - r || j == cj + r);
+      for (int i = ci - r; i <= ci + r; i += (edge ? 1 : 2 * r)) {
+        if (i >= 0 && i < this->ncellx) {
+          int c = j * this->ncellx + i;
+          for (int k = this->cellstart[c]; k < this->cellstart[c + 1]; ++k) {
+            double dx = qx - this->hx[k];
+            double dy = py - this->hy[k];
+            double d2 = dx * dx + dy * dy;
+            if (d2 < best2 || (d2 == best2 && this->index[k] < best)) {
+              best2 = d2;
+              best = this->index[k];
+            }
+          }
+        }
+        if (r == 0)
+          break;
+      }
+    }
+    double reach = r * this->cellsize;
+    if (best >= 0 && best2 <= reach * reach)
+      break;
+  }
+  *dist = sqrt(best2);
+  return best;
+}
+
+void SpatialHash::region(double x0, double y0, double x1, double y1, std::vector<int> * found) const {
+  found->clear();
+  if (this->index.empty())
+    return;
+
+  double ax = x0 / ASPECT, bx = x1 / ASPECT;
+  int i0, j0, i1, j1;
+  cellof(ax - this->cellsize, y0 - this->cellsize, &i0, &j0);
+  cellof(bx + this->cellsize, y1 + this->cellsize, &i1, &j1);
+  for (int j = j0; j <= j1; ++j) {
+    for (int i = i0; i <= i1; ++i) {
+      int c = j * this->ncellx + i;
+      for (int k = this->cellstart[c]; k < this->cellstart[c + 1]; ++k) {
+        double r = sqrt(this->rad2[k]);
+        if (this->hx[k] + r >= ax && this->hx[k] - r <= bx && this->hy[k] + r >= y0 && this->hy[k] - r <= y1)
+          found->push_back(this->index[k]);
+      }
+    }
+  }
+}
@@ -0,0 +1,69 @@
+#ifndef SPATIALHASH_H
+#define SPATIALHASH_H
+
+#include <vector>
+
+class BodyStore;
+
+// Where a moving point first touches a body
+struct Contact {
+  int body;           // Index of the body, -1 if none
+  double t;           // Fraction of the way along the segment, 0 - 1
+  double x, y;        // Point of contact, in screen units
+};
+
+// Uniform grid over a fixed set of bodies for collision queries.
+// Each cell is as wide as the largest collision radius, so any body
+// a point can be inside of sits in that point's cell or one of its
+// eight neighbours. Bodies are stored cell by cell with their
+// squared radii, so a query touches only a few contiguous runs.
+class SpatialHash {
+
+
+  public:
+
+    SpatialHash();
+
+    void build(const BodyStore &);
+    void clear();
+
+    // Index of the body whose collision radius contains (px, py),
+    // or -1. If several do, the lowest index wins, as in the linear scan.
+    int query(double, double) const;
+
+    // Continuous version of query for a point moving in a straight
+    // line from (x0, y0) to (x1, y1). Finds the first body whose
+    // collision radius the segment enters, so fast points can't skip
+    // through small bodies. Earliest contact wins, then lowest index.
+    bool sweep(double, double, double, double, Contact *) const;
+
+    // Index of the body whose center is closest to (px, py), or -1 if
+    // there are none, and the distance to it in the half-width x units
+    // the collision check uses. Searches outward a ring of cells at a
+    // time, so nearby bodies are found without looking at the rest.
+    int nearest(double, double, double *) const;
+
+    // Every body whose collision circle's bounding box overlaps the
+    // rectangle from (x0, y0) to (x1, y1), in screen units, replacing
+    // what was in the vector. Only the cells under the rectangle are
+    // looked at, so a small window into a big field stays cheap.
+    void region(double, double, double, double, std::vector<int> *) const;
+
+
+  protected:
+
+    int cellof(double, double, int *, int *) const;
+
+    double cellsize;
+    double originx, originy;     // Corner of the grid, x already divided by ASPECT
+    int ncellx, ncelly;
+
+    std::vector<int> cellstart;  // Offset of each cell's run in the arrays below
+    std::vector<int> index;      // Body index
+    std::vector<double> hx;      // Body x over ASPECT
+    std::vector<double> hy;
+    std::vector<double> rad2;    // Squared collision radius
+
+};
+
+#endif
@@ -0,0 +1,138 @@
+#include<cmath>
+#include<map>
+#include<memory>
+#include<string>
+#include<vector>
+#include"Sprites.h"
+
+// Hand drawn circles, with the row offsets and widths worked out by
+// the compiler
+static constexpr SpriteRow rows3[] = {
+  spriterow(3, "__"),
+  spriterow(3, "/  \\"),
+  spriterow(3, "\\__/")
+};
+
+static constexpr SpriteRow rows4[] = {
+  spriterow(4, "___"),
+  spriterow(4, "/   \\"),
+  spriterow(4, "|     |"),
+  spriterow(4, "\\___/")
+};
+
+static constexpr SpriteRow rows5[] = {
+  spriterow(5, ".-''-."),
+  spriterow(5, "/      \\"),
+  spriterow(5, "|        |"),
+  spriterow(5, "\\      /"),
+  spriterow(5, "`-..-'")
+};
+
+static constexpr SpriteRow rows6[] = {
+  spriterow(6, "____"),
+  spriterow(6, ".'    `."),
+  spriterow(6, "/        \\"),
+  spriterow(6, "|        |"),
+  spriterow(6, "\\        /"),
+  spriterow(6, "`.____.'")
+};
+
+static constexpr SpriteRow rows9[] = {
+  spriterow(9, "_.-\"\"\"\"-._"),
+  spriterow(9, ".'          `."),
+  spriterow(9, "/              \\"),
+  spriterow(9, "|                |"),
+  spriterow(9, "|                |"),
+  spriterow(9, "|                |"),
+  spriterow(9, "\\              /"),
+  spriterow(9, "`._        _.'"),
+  spriterow(9, "`-....-'")
+};
+
+static constexpr Sprite atlas[] = {
+  {3, 3, rows3},
+  {4, 4, rows4},
+  {5, 5, rows5},
+  {6, 6, rows6},
+  {9, 9, rows9}
+};
+
+static_assert(rows9[3].offset == 0 && rows9[3].width == 18, "size 9 sprite fills its box");
+
+
+namespace {
+
+// A sprite rasterised at run time. Owns the text its rows point to.
+struct CachedSprite {
+  Sprite sprite;
+  std::string text;
+  std::vector<SpriteRow> rows;
+};
+
+// Draws the outline of a circle of size s: flat on top and bottom,
+// slanted where the edge moves more than a column per line, and
+// straight up the sides in between
+CachedSprite * rasterise(int s) {
+  CachedSprite * c = new CachedSprite;
+  std::vector<int> widths(s);
+  double r = s / 2.0;
+  for (int i = 0; i < s; ++i) {
+    double y = i + 0.5 - r;
+    int w = 2 * (int)floor(2 * sqrt(fmax(r * r - y * y, 0)) + 0.5);   // Twice the chord, rounded to even so it centers
+    widths[i] = (w < 2 ? 2 : w);
+  }
+
+  std::vector<std::string> lines(s);
+  for (int i = 0; i < s; ++i) {
+    int w = widths[i];
+    std::string inside(w - 2, ' ');
+    if (i == 0)
+      lines[i] = std::string(w, '_');
+    else if (i == s - 1)
+      lines[i] = "`" + std::string(w - 2, '-') + "'";
+    else if (widths[i] - widths[i - 1] > 2 || (i == 1 && widths[i] > widths[0]))
+      lines[i] = "/" + inside + "\\";
+    else if (widths[i + 1] < widths[i] - 2)
+      lines[i] = "\\" + inside + "/";
+    else
+      lines[i] = "|" + inside + "|";
+  }
+
+  // Row pointers go in only once the text is complete, so it never
+  // reallocates under them
+  std::vector<int> start(s);
+  for (int i = 0; i < s; ++i) {
+    start[i] = c->text.size();
+    c->text += lines[i];
+  }
+  for (int i = 0; i < s; ++i) {
+    SpriteRow row = {(2 * s - widths[i]) / 2, widths[i], c->text.c_str() + start[i]};
+    c->rows.push_back(row);
+  }
+  c->sprite.size = s;
+  c->sprite.nrows = s;
+  c->sprite.rows = c->rows.data();
+  return c;
+}
+
+}
+
+const Sprite & findsprite(int size) {
+  for (unsigned a = 0; a < sizeof(atlas) / sizeof(atlas[0]); ++a) {
+    if (atlas[a].size == size)
+      return atlas[a];
+  }
+
+  static std::map<int, std::unique_ptr<CachedSprite> > cache;
+  std::unique_ptr<CachedSprite> & c = cache[size];
+  if (!c)
+    c.reset(rasterise(size > 0 ? size : 0));
+  return c->sprite;
+}
+
+const char * spriteblank(int size) {
+  static std::string blank;
+  if ((int)blank.size() < 2 * size)
+    blank.assign(2 * size, ' ');
+  return blank.c_str();
+}
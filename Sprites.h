@@ -0,0 +1,41 @@
+#ifndef SPRITES_H
+#define SPRITES_H
+
+// Glyphs for drawing circles of each size. A circle of size s is
+// s lines tall and 2 * s columns wide, since chars are twice as tall
+// as they are wide. Each row is a run of text that starts "offset"
+// columns in from the left edge of that box.
+
+struct SpriteRow {
+  int offset;          // Columns to skip before the text
+  int width;           // Length of the text
+  const char * text;
+};
+
+struct Sprite {
+  int size;
+  int nrows;
+  const SpriteRow * rows;
+};
+
+// Length of a string, usable at compile time
+constexpr int spritelen(const char * s) {
+  return *s ? 1 + spritelen(s + 1) : 0;
+}
+
+// Builds a row of a size s circle, centering the text in the box
+constexpr SpriteRow spriterow(int s, const char * text) {
+  return SpriteRow{(2 * s - spritelen(text)) / 2, spritelen(text), text};
+}
+
+// Returns the sprite for a circle of the given size. Sizes 3, 4, 5,
+// 6 and 9 come from a hand drawn atlas built at compile time; any
+// other size is rasterised the first time it is asked for and
+// cached. Not thread safe, like the rest of the display code.
+const Sprite & findsprite(int);
+
+// Blank text at least as wide as any row of a sprite of this size,
+// for erasing it
+const char * spriteblank(int);
+
+#endif
@@ -0,0 +1,122 @@
+#include"Sweep.h"
+#include"Scheduler.h"
+#include"Sim.h"
+#include"Salvo.h"
+
+SweepSpec defaultsweep(int nangles, int nspeeds) {
+  SweepSpec spec;
+  spec.angle0 = 0;
+  spec.angle1 = 360;
+  spec.nangles = nangles;
+  spec.speed0 = 0;
+  spec.speed1 = 10;
+  spec.nspeeds = nspeeds;
+  spec.shooter = 0;
+  spec.maxsteps = MAXSTEPS;
+  spec.band = 8;
+  spec.threads = 0;
+  return spec;
+}
+
+int16_t HitMap::gethit(int a, int s) const {
+  return this->hit[(size_t)a * this->spec.nspeeds + s];
+}
+
+uint16_t HitMap::getsteps(int a, int s) const {
+  return this->steps[(size_t)a * this->spec.nspeeds + s];
+}
+
+// Value i of n evenly spaced samples from lo to hi
+static double sample(double lo, double hi, int i, int n) {
+  return (n > 1 ? lo + (hi - lo) * i / (n - 1) : lo);
+}
+
+// Angle i of n evenly spaced over [lo, hi). Angles wrap, so taking
+// both ends of 0 - 360 would fire the same shot twice.
+static double anglesample(double lo, double hi, int i, int n) {
+  return lo + (hi - lo) * i / n;
+}
+
+HitMap sweep(const Layout & layout, const SweepSpec & spec) {
+  HitMap map;
+  map.spec = spec;
+  size_t cells = (size_t)spec.nangles * spec.nspeeds;
+  map.hit.assign(cells, -1);
+  map.steps.assign(cells, 0);
+
+  // Each task is a band of neighbouring angles. Neighbouring shots
+  // take similar paths, so a band touches the same part of the
+  // field and its cost is fairly even.
+  int band = (spec.band > 0 ? spec.band : 1);
+  int ntasks = (spec.nangles + band - 1) / band;
+  int16_t * hit = map.hit.data();
+  uint16_t * steps = map.steps.data();
+
+  runtasks(ntasks, spec.threads, [&](int task) {
+    int first = task * band;
+    int last = (first + band < spec.nangles ? first + band : spec.nangles);
+    for (int a = first; a < last; ++a) {
+      double angle = anglesample(spec.angle0, spec.angle1, a, spec.nangles);
+      for (int s = 0; s < spec.nspeeds; ++s) {
+        double speed = sample(spec.speed0, spec.speed1, s, spec.nspeeds);
+        ShotResult r = simulate_shot(layout, speed, angle, spec.shooter, spec.maxsteps);
+        size_t k = (size_t)a * spec.nspeeds + s;
+        hit[k] = r.hit;
+        steps[k] = (r.steps < 65535 ? r.steps : 65535);
+      }
+    }
+  });
+
+  return map;
+}
+
+HitMap sweepsalvo(const Layout & layout, const SweepSpec & spec, int salvosize) {
+  HitMap map;
+  map.spec = spec;
+  size_t cells = (size_t)spec.nangles * spec.nspeeds;
+  map.hit.assign(cells, -1);
+  map.steps.assign(cells, 0);
+
+  size_t size = (salvosize > 0 ? salvosize : 1);
+  int ntasks = (cells + size - 1) / size;
+  int16_t * hit = map.hit.data();
+  uint16_t * steps = map.steps.data();
+
+  runtasks(ntasks, spec.threads, [&](int task) {
+    size_t first = task * size;
+    size_t last = (first + size < cells ? first + size : cells);
+    Salvo salvo(layout);
+    salvo.reserve(last - first);
+    for (size_t k = first; k < last; ++k) {
+      double angle = anglesample(spec.angle0, spec.angle1, k / spec.nspeeds, spec.nangles);
+      double speed = sample(spec.speed0, spec.speed1, k % spec.nspeeds, spec.nspeeds);
+      salvo.fire(speed, angle, spec.shooter);
+    }
+    for (int s = 0; s < spec.maxsteps && salvo.step() > 0; ++s)
+      ;
+    salvo.stop();
+    for (size_t k = first; k < last; ++k) {
+      Handle m = salvo.missile(k - first);
+      hit[k] = salvo.gethit(m);
+      steps[k] = (salvo.getsteps(m) < 65535 ? salvo.getsteps(m) : 65535);
+    }
+  });
+
+  return map;
+}
+
+bool writehitmap(const HitMap & map, FILE * out) {
+  const SweepSpec & s = map.spec;
+  int32_t dims[2] = {s.nangles, s.nspeeds};
+  double ranges[4] = {s.angle0, s.angle1, s.speed0, s.speed1};
+  int32_t shooter = s.shooter;
+  size_t cells = map.hit.size();
+
+  bool ok = fwrite("BPHM", 1, 4, out) == 4;
+  ok = ok && fwrite(dims, sizeof(dims), 1, out) == 1;
+  ok = ok && fwrite(ranges, sizeof(ranges), 1, out) == 1;
+  ok = ok && fwrite(&shooter, sizeof(shooter), 1, out) == 1;
+  ok = ok && fwrite(map.hit.data(), sizeof(int16_t), cells, out) == cells;
+  ok = ok && fwrite(map.steps.data(), sizeof(uint16_t), cells, out) == cells;
+  return ok;
+}
@@ -0,0 +1,50 @@
+#ifndef SWEEP_H
+#define SWEEP_H
+
+#include <cstdio>
+#include <vector>
+#include <stdint.h>
+
+struct Layout;
+
+// What to sweep. Speeds are sampled evenly, including both ends of
+// the range; angles evenly from angle0 up to but not including angle1.
+struct SweepSpec {
+  double angle0, angle1;   // Degrees, as typed into the game
+  int nangles;
+  double speed0, speed1;
+  int nspeeds;
+  int shooter;             // Planet the shots are fired from
+  int maxsteps;            // Step cap for each shot
+  int band;                // Angles per task; threads steal whole bands
+  int threads;             // 0 for one per core
+};
+
+// Fills in a spec covering the ranges the game accepts
+// (0 - 360 degrees, 0 - 10 speed) at the given resolution
+SweepSpec defaultsweep(int, int);
+
+// Outcome of every (angle, speed) pair, angle-major. hit holds the
+// first body hit, or -1 for a miss; steps holds the steps taken.
+struct HitMap {
+  SweepSpec spec;
+  std::vector<int16_t> hit;
+  std::vector<uint16_t> steps;
+
+  int16_t gethit(int, int) const;
+  uint16_t getsteps(int, int) const;
+};
+
+// Fires every shot in the spec against the layout, in parallel
+HitMap sweep(const Layout &, const SweepSpec &);
+
+// The same sweep fired as salvos of up to n missiles in flight at
+// once (see Salvo.h) rather than one shot at a time. Each task is a
+// salvo, so threads share the work as in sweep().
+HitMap sweepsalvo(const Layout &, const SweepSpec &, int);
+
+// Writes the map in a compact binary form: the "BPHM" magic, the
+// spec, then the hit and step arrays
+bool writehitmap(const HitMap &, FILE *);
+
+#endif
@@ -0,0 +1,319 @@
+#include<cstddef>
+#include<cstring>
+#include<fcntl.h>
+#include<unistd.h>
+#include<sys/mman.h>
+#include<sys/stat.h>
+#include"Trajectory.h"
+
+// The file grows by doubling from this size, so the writer seldom
+// has to remap
+static const size_t INITIALMAP = 16 << 20;
+
+// Bumped whenever a sink opens or closes, so a thread holding a block
+// from an earlier sink lets go of it rather than handing it back. The
+// sink took it back when it closed.
+static std::atomic<unsigned> sinkepoch(0);
+
+// The block this thread is filling. When the thread exits, whatever
+// it holds goes to the writer.
+struct TrajectoryOwner {
+  TrajectorySink * sink;
+  unsigned epoch;
+  TrajectorySink::Block * block;
+
+  TrajectoryOwner() : sink(NULL), epoch(0), block(NULL) {}
+  ~TrajectoryOwner() { this->release(); }
+
+  void release() {
+    if (this->block && this->sink && this->epoch == sinkepoch.load())
+      this->sink->submit(this->block);
+    this->block = NULL;
+    this->sink = NULL;
+  }
+};
+
+static thread_local TrajectoryOwner owner;
+
+TrajectorySink::TrajectorySink() : shots(0), written(0), dropped(0) {
+  this->fd = -1;
+  this->map = NULL;
+  this->mapsize = 0;
+  this->length = 0;
+  this->allocated = 0;
+  this->closing = false;
+}
+
+TrajectorySink::~TrajectorySink() {
+  this->close();
+}
+
+bool TrajectorySink::open(const char * name, uint64_t seed) {
+  this->close();
+  this->fd = ::open(name, O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (this->fd < 0)
+    return false;
+  if (!this->reserve(INITIALMAP)) {
+    ::close(this->fd);
+    this->fd = -1;
+    return false;
+  }
+
+  TrajectoryHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, "BPTR", 4);
+  header.version = 1;
+  header.recordsize = sizeof(TrajectoryRecord);
+  header.seed = seed;
+  memcpy(this->map, &header, sizeof(header));
+  this->length = sizeof(header);
+
+  this->shots = 0;
+  this->written = 0;
+  this->dropped = 0;
+  this->closing = false;
+  ++sinkepoch;
+  this->writer = std::thread(&TrajectorySink::drain, this);
+  return true;
+}
+
+void TrajectorySink::close() {
+  if (this->fd < 0)
+    return;
+  if (owner.sink == this)
+    owner.release();                          // This thread's last, part-filled block
+  {
+    // Other threads that are still around but done adding hold
+    // part-filled blocks too; they go out the same way
+    std::lock_guard<std::mutex> guard(this->lock);
+    for (size_t i = 0; i < this->filling.size(); ++i)
+      this->full.push_back(this->filling[i]);
+    this->filling.clear();
+    this->closing = true;
+  }
+  this->wake.notify_one();
+  this->writer.join();
+  ++sinkepoch;
+
+  uint64_t records = this->written.load();
+  memcpy(this->map + offsetof(TrajectoryHeader, records), &records, sizeof(records));
+  munmap(this->map, this->mapsize);
+  if (ftruncate(this->fd, this->length) != 0)
+    this->length = this->mapsize;             // Readers go by the count in the header
+  ::close(this->fd);
+  this->fd = -1;
+  this->map = NULL;
+  this->mapsize = 0;
+  for (size_t i = 0; i < this->spare.size(); ++i)
+    delete this->spare[i];
+  this->spare.clear();
+  this->allocated = 0;
+}
+
+uint32_t TrajectorySink::newshot() {
+  return this->shots++;
+}
+
+void TrajectorySink::add(const TrajectoryRecord & record) {
+  TrajectoryOwner & o = owner;
+  unsigned epoch = sinkepoch.load(std::memory_order_relaxed);
+  if (o.sink != this || o.epoch != epoch) {
+    o.release();
+    o.sink = this;
+    o.epoch = epoch;
+  }
+  if (!o.block) {
+    o.block = this->getblock();
+    if (!o.block) {
+      this->dropped.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+  }
+  o.block->records[o.block->count++] = record;
+  if (o.block->count == TRAJECTORYBLOCK) {
+    this->submit(o.block);
+    o.block = NULL;
+  }
+}
+
+long TrajectorySink::getwritten() const {
+  return this->written.load();
+}
+
+long TrajectorySink::getdropped() const {
+  return this->dropped.load();
+}
+
+TrajectorySink::Block * TrajectorySink::getblock() {
+  Block * b = NULL;
+  {
+    std::lock_guard<std::mutex> guard(this->lock);
+    if (!this->spare.empty()) {
+      b = this->spare.back();
+      this->spare.pop_back();
+    }
+    else if (this->allocated < TRAJECTORYQUEUE) {
+      ++this->allocated;
+    }
+    else {
+      return NULL;
+    }
+  }
+  if (!b)
+    b = new Block;
+  b->count = 0;
+  std::lock_guard<std::mutex> guard(this->lock);
+  this->filling.push_back(b);
+  return b;
+}
+
+void TrajectorySink::submit(Block * b) {
+  {
+    std::lock_guard<std::mutex> guard(this->lock);
+    for (size_t i = 0; i < this->filling.size(); ++i) {
+      if (this->filling[i] == b) {
+        this->filling[i] = this->filling.back();
+        this->filling.pop_back();
+        break;
+      }
+    }
+    this->full.push_back(b);
+  }
+  this->wake.notify_one();
+}
+
+bool TrajectorySink::reserve(size_t bytes) {
+  if (bytes <= this->mapsize)
+    return true;
+  size_t size = (this->mapsize ? this->mapsize : INITIALMAP);
+  while (size < bytes)
+    size *= 2;
+  if (ftruncate(this->fd, size) != 0)
+    return false;
+  if (this->map)
+    munmap(this->map, this->mapsize);
+  void * p = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, this->fd, 0);
+  if (p == MAP_FAILED) {
+    this->map = NULL;
+    this->mapsize = 0;
+    return false;
+  }
+  this->map = (char *)p;
+  this->mapsize = size;
+  return true;
+}
+
+// Copies blocks into the mapping as they arrive, until the sink
+// closes and the queue is empty
+void TrajectorySink::drain() {
+  std::unique_lock<std::mutex> guard(this->lock);
+  for (;;) {
+    this->wake.wait(guard, [this] { return !this->full.empty() || this->closing; });
+    if (this->full.empty())
+      break;
+    Block * b = this->full.front();
+    this->full.pop_front();
+    guard.unlock();
+
+    size_t bytes = b->count * sizeof(TrajectoryRecord);
+    if (this->reserve(this->length + bytes)) {
+      memcpy(this->map + this->length, b->records, bytes);
+      this->length += bytes;
+      this->written.fetch_add(b->count, std::memory_order_relaxed);
+    }
+    else {
+      this->dropped.fetch_add(b->count, std::memory_order_relaxed);   // Out of disk or address space
+    }
+
+    guard.lock();
+    this->spare.push_back(b);
+  }
+}
+
+// Bytes of the file the reader maps at once
+static const size_t READWINDOW = 16 << 20;
+
+TrajectoryReader::TrajectoryReader() {
+  this->fd = -1;
+  this->end = 0;
+  this->pos = 0;
+  this->window = NULL;
+  this->winstart = 0;
+  this->winsize = 0;
+}
+
+TrajectoryReader::~TrajectoryReader() {
+  this->close();
+}
+
+bool TrajectoryReader::open(const char * name) {
+  this->close();
+  this->fd = ::open(name, O_RDONLY);
+  if (this->fd < 0)
+    return false;
+  struct stat st;
+  bool ok = fstat(this->fd, &st) == 0;
+  ok = ok && read(this->fd, &this->header, sizeof(this->header)) == (ssize_t)sizeof(this->header);
+  ok = ok && !memcmp(this->header.magic, "BPTR", 4) && this->header.recordsize == sizeof(TrajectoryRecord);
+  if (!ok) {
+    this->close();
+    return false;
+  }
+
+  // A file whose writer never closed it has no count, and may run on
+  // past its records to the end of what was mapped
+  size_t records = (st.st_size - sizeof(this->header)) / sizeof(TrajectoryRecord);
+  if (this->header.records > 0 && this->header.records < records)
+    records = this->header.records;
+  this->end = sizeof(this->header) + records * sizeof(TrajectoryRecord);
+  this->pos = sizeof(this->header);
+  return true;
+}
+
+void TrajectoryReader::close() {
+  if (this->window)
+    munmap(this->window, this->winsize);
+  this->window = NULL;
+  this->winsize = 0;
+  if (this->fd >= 0)
+    ::close(this->fd);
+  this->fd = -1;
+}
+
+const TrajectoryHeader & TrajectoryReader::getheader() const {
+  return this->header;
+}
+
+long TrajectoryReader::count() const {
+  return (this->end - sizeof(this->header)) / sizeof(TrajectoryRecord);
+}
+
+// Maps the window starting at the page holding offset
+bool TrajectoryReader::mapwindow(size_t offset) {
+  if (this->window)
+    munmap(this->window, this->winsize);
+  this->window = NULL;
+  size_t page = sysconf(_SC_PAGESIZE);
+  this->winstart = offset / page * page;
+  this->winsize = this->end - this->winstart;
+  if (this->winsize > READWINDOW)
+    this->winsize = READWINDOW;
+  void * p = mmap(NULL, this->winsize, PROT_READ, MAP_SHARED, this->fd, this->winstart);
+  if (p == MAP_FAILED)
+    return false;
+  this->window = (char *)p;
+  madvise(this->window, this->winsize, MADV_SEQUENTIAL);
+  return true;
+}
+
+const TrajectoryRecord * TrajectoryReader::next() {
+  if (this->fd < 0 || this->pos + sizeof(TrajectoryRecord) > this->end)
+    return NULL;
+  if (!this->window || this->pos + sizeof(TrajectoryRecord) > this->winstart + this->winsize) {
+    if (!this->mapwindow(this->pos))
+      return NULL;
+  }
+  const TrajectoryRecord * r = (const TrajectoryRecord *)(this->window + (this->pos - this->winstart));
+  this->pos += sizeof(TrajectoryRecord);
+  return r;
+}
@@ -0,0 +1,142 @@
+#ifndef TRAJECTORY_H
+#define TRAJECTORY_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <stdint.h>
+
+// Every step of every shot, for offline analysis. A sink set on a
+// Layout gets one fixed-width record per step from Shot::step.
+//
+// The file is a TrajectoryHeader followed by the records, in the
+// order their blocks were written. Records from one thread stay in
+// step order; shots from different threads interleave by block.
+
+struct TrajectoryHeader {
+  char magic[4];        // "BPTR"
+  uint32_t version;
+  uint32_t recordsize;  // sizeof(TrajectoryRecord)
+  uint32_t reserved;
+  uint64_t seed;        // Seed of the layout, if the writer knew it
+  uint64_t records;     // Filled in on close; 0 if the writer never got there
+};
+
+struct TrajectoryRecord {
+  uint32_t shot;        // Shots are numbered from 0 as they start
+  uint32_t step;        // Step within the shot, from 1
+  float x, y;           // Position after the step
+  float vx, vy;         // Velocity after the step
+  float fx, fy;         // Force on the missile at the start of the step
+  int32_t nearest;      // Body with the closest center
+  float distance;       // to that center, in the collision check's units
+};
+
+// Number of records in a block. Each thread fills a block of its own
+// and hands it to the writer whole.
+const int TRAJECTORYBLOCK = 8192;
+
+// Blocks in use at most, filling or waiting for the writer. Past
+// that, records are dropped and counted rather than making the
+// simulation wait.
+const int TRAJECTORYQUEUE = 256;
+
+// Appends records to a memory-mapped file. The simulation threads
+// only copy records into their own block; a writer thread moves full
+// blocks into the mapping and grows the file, so no I/O or waiting
+// happens on the simulation's side. One sink may be open at a time.
+class TrajectorySink {
+
+
+  public:
+
+    TrajectorySink();
+    ~TrajectorySink();
+
+    bool open(const char *, uint64_t = 0);
+
+    // Writes everything out, including the blocks other threads were
+    // still filling, and truncates the file to its contents. Threads
+    // that added records must be done adding.
+    void close();
+
+    uint32_t newshot();
+    void add(const TrajectoryRecord &);
+
+    long getwritten() const;    // Records in the file
+    long getdropped() const;    // Records lost to a full queue
+
+
+  protected:
+
+    struct Block {
+      int count;
+      TrajectoryRecord records[TRAJECTORYBLOCK];
+    };
+
+    friend struct TrajectoryOwner;
+
+    Block * getblock();              // Empty block, or NULL if too many are waiting
+    void submit(Block *);            // Queues a block for the writer
+    void drain();                    // The writer thread
+    bool reserve(size_t);            // Grows the file and mapping to hold this many bytes
+
+    int fd;
+    char * map;
+    size_t mapsize;
+    size_t length;                   // Bytes of the file in use
+
+    std::thread writer;
+    std::mutex lock;
+    std::condition_variable wake;
+    std::deque<Block *> full;        // Waiting for the writer, oldest first
+    std::vector<Block *> filling;    // Handed to a thread and not yet back
+    std::vector<Block *> spare;
+    int allocated;
+    bool closing;
+
+    std::atomic<uint32_t> shots;
+    std::atomic<long> written;
+    std::atomic<long> dropped;
+
+};
+
+// Streams the records of a trajectory file back through a window
+// mapped a piece at a time, so files far bigger than memory can be
+// read in one pass.
+class TrajectoryReader {
+
+
+  public:
+
+    TrajectoryReader();
+    ~TrajectoryReader();
+
+    bool open(const char *);      // False if it isn't a trajectory file
+    void close();
+
+    const TrajectoryHeader & getheader() const;
+    long count() const;           // Records in the file
+
+    // The next record, or NULL at the end. Good until the next call.
+    const TrajectoryRecord * next();
+
+
+  protected:
+
+    bool mapwindow(size_t);
+
+    int fd;
+    TrajectoryHeader header;
+    size_t end;                   // Offset just past the last record
+    size_t pos;                   // Offset of the next record
+    char * window;
+    size_t winstart;
+    size_t winsize;
+
+};
+
+#endif
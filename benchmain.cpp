@@ -0,0 +1,352 @@
+/*
+ * benchmark
+ *
+ * Times the parts of a turn that matter for speed: the force sum,
+ * the collision query, laying out planets and drawing, at sizes from
+ * a game's worth of bodies up to 100k, then whole shots over fixed
+ * seeded layouts. Writes the results as JSON and, given a baseline
+ * from an earlier run, reports how each one has moved.
+ *
+ */
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <chrono>
+#include <ncurses.h>
+#include "Sim.h"
+#include "Display.h"
+#include "Salvo.h"
+#include "Camera.h"
+
+using namespace std;
+
+struct BenchResult {
+  string name;
+  int n;              // Bodies in the field, or shots per layout for the macro benchmarks
+  double ns;          // Best time per operation over the repeats
+};
+
+static vector<BenchResult> results;
+static double mintime = 0.05;    // Seconds each timed repeat should run for
+static volatile double sink;     // Keeps the compiler from dropping work whose result is unused
+
+static double seconds(chrono::steady_clock::time_point start) {
+  return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+// Times op(reps) with reps doubled until a run takes mintime, then
+// keeps the best of three runs of that length; an op that does the
+// work of several shots passes how many as per
+template<class F> static void bench(const string & name, int n, F op, int per = 1) {
+  long reps = 1;
+  double t;
+  for (;;) {
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    op(reps);
+    t = seconds(start);
+    if (t >= mintime || reps >= (1L << 40))
+      break;
+    reps = (long)(reps * (t > 0 ? min(max(2.0, 1.2 * mintime / t), 100.0) : 100.0));
+  }
+  double best = t;
+  for (int r = 0; r < 2; ++r) {
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    op(reps);
+    best = min(best, seconds(start));
+  }
+
+  BenchResult result;
+  result.name = name;
+  result.n = n;
+  result.ns = best * 1e9 / reps / per;
+  results.push_back(result);
+  fprintf(stderr, "%-20s %7d %14.1f ns\n", name.c_str(), n, result.ns);
+}
+
+// Scatters n bodies of the game's sizes over a field that keeps
+// about the game's density of planets
+static void fillfield(Layout & layout, int n, unsigned seed) {
+  srand(seed);
+  layout.nlines = (int)sqrt(210.0 * n) + 10;
+  layout.ncols = layout.nlines * 10 / 3;
+  layout.planets.clear();
+  layout.planets.reserve(n);
+  for (int i = 0; i < n; ++i) {
+    double x = 2 + rand() % (layout.ncols - 4);
+    double y = 3 + rand() % (layout.nlines - 6);
+    layout.planets.add(x, y, 3 + rand() % 7);
+  }
+  layout.hash.build(layout.planets);
+  layout.tree.build(layout.planets);
+}
+
+// Missiles spread over the field, so the timings aren't one point's
+static vector<Missile> probes(const Layout & layout) {
+  vector<Missile> out;
+  for (int i = 0; i < 64; ++i) {
+    double x = 2 + (layout.ncols - 4) * ((i * 37) % 64) / 64.0;
+    double y = 3 + (layout.nlines - 6) * ((i * 11) % 64) / 64.0;
+    out.push_back(Missile(x, y, 0, 0, 0));
+  }
+  return out;
+}
+
+static void microbenchmarks() {
+  int sizes[] = {10, 100, 1000, 10000, 100000};
+  for (int s = 0; s < 5; ++s) {
+    int n = sizes[s];
+    Layout layout;
+    fillfield(layout, n, n);
+    vector<Missile> missiles = probes(layout);
+
+    bench("getforce.exact", n, [&](long reps) {
+      double force[2], total = 0;
+      for (long r = 0; r < reps; ++r) {
+        missiles[r & 63].getforce(layout.planets, force, FORCE_NEWTON);
+        total += force[0];
+      }
+      sink = total;
+    });
+    for (int law = FORCE_SOFTENED; law < FORCELAWS; ++law) {     // Each law's own kernel; should cost what newton does
+      bench(string("getforce.") + forcelawname(law), n, [&](long reps) {
+        double force[2], total = 0;
+        for (long r = 0; r < reps; ++r) {
+          missiles[r & 63].getforce(layout.planets, force, law);
+          total += force[0];
+        }
+        sink = total;
+      });
+    }
+    bench("getforce.tree", n, [&](long reps) {
+      double force[2], total = 0;
+      for (long r = 0; r < reps; ++r) {
+        missiles[r & 63].getforce(layout.tree, force, FORCE_NEWTON);
+        total += force[0];
+      }
+      sink = total;
+    });
+    bench("checkcollision", n, [&](long reps) {
+      long total = 0;
+      for (long r = 0; r < reps; ++r)
+        total += checkcollision(missiles[r & 63], layout);
+      sink = total;
+    });
+    bench("arrangeplanets", n, [&](long reps) {
+      Layout fresh;
+      for (long r = 0; r < reps; ++r)
+        arrangeplanets(fresh, n, layout.nlines, layout.ncols, r);
+      sink = fresh.planets.count();
+    });
+  }
+}
+
+// Angles and speeds each layout is fired at
+const int MACROANGLES = 36;
+const int MACROSPEEDS = 10;
+const int MACROSEEDS = 8;
+
+static void shotbenchmark(const string & name, int integrator, bool swept) {
+  vector<Layout> layouts(MACROSEEDS);
+  for (int s = 0; s < MACROSEEDS; ++s) {
+    arrangeplanets(layouts[s], 17, 60, 200, s + 1);
+    layouts[s].integrator = integrator;
+    layouts[s].swept = swept;
+  }
+  int pershot = MACROANGLES * MACROSPEEDS;
+  bench(name, pershot, [&](long reps) {
+    long steps = 0;
+    for (long r = 0; r < reps; ++r) {
+      int k = r % (MACROSEEDS * pershot);
+      int a = k % MACROANGLES, v = (k / MACROANGLES) % MACROSPEEDS;
+      ShotResult result = simulate_shot(layouts[k / pershot], v + 1, a * 10, 0, 500);
+      steps += result.steps;
+    }
+    sink = steps;
+  });
+}
+
+// A salvo of n missiles over the same angles and speeds, flown to
+// the end; each op is one salvo, reported per missile so it compares
+// with the shots above
+static void salvobenchmark(int n) {
+  Layout layout;
+  arrangeplanets(layout, 17, 60, 200, 1);
+  Salvo salvo(layout);
+  salvo.reserve(n);
+  bench("salvo.euler", n, [&](long reps) {
+    long steps = 0;
+    for (long r = 0; r < reps; ++r) {
+      salvo.clear();
+      for (int k = 0; k < n; ++k)
+        salvo.fire(k % MACROSPEEDS + 1, (k / MACROSPEEDS) % MACROANGLES * 10 + k / (MACROANGLES * MACROSPEEDS), 0);
+      for (int s = 0; s < 500 && salvo.step() > 0; ++s)
+        ++steps;
+    }
+    sink = steps;
+  }, n);
+}
+
+static void macrobenchmarks() {
+  shotbenchmark("shot.euler", INTEGRATE_EULER, false);
+  shotbenchmark("shot.euler.swept", INTEGRATE_EULER, true);
+  shotbenchmark("shot.verlet", INTEGRATE_VERLET, false);
+  shotbenchmark("shot.rk45", INTEGRATE_RK45, false);
+  salvobenchmark(100);
+  salvobenchmark(10000);
+}
+
+// The draw path, into a terminal that goes nowhere: a full board
+// redraw as after a new layout, the same for a window into a large
+// field, and one frame of a missile in flight
+static void drawbenchmarks() {
+  Layout layout;
+  arrangeplanets(layout, 17, 60, 200, 1);
+  startnulldisplay(60, 200);
+
+  bench("draw.board", layout.planets.count(), [&](long reps) {
+    for (long r = 0; r < reps; ++r) {
+      erase();
+      for (int i = 0; i < layout.planets.count(); ++i)
+        printcircle(layout.planets.getx(i), layout.planets.gety(i), layout.planets.getsize(i));
+      presentframe();
+    }
+  });
+
+  // The same redraw through a terminal sized window into a field
+  // fifty times the area. Only what's in the window is looked at, so
+  // this should cost about what a board the size of the window does.
+  Layout world;
+  arrangeplanets(world, 60 * 200 * 50 / 700, 60 * 5, 200 * 10, 1);
+  Camera camera;
+  camera.setworld(60 * 5, 200 * 10);
+  camera.setwindow(3, 0, 53, 200);
+  camera.center(1000, 150);
+  setviewport(camera.getview());
+  bench("draw.world", world.planets.count(), [&](long reps) {
+    for (long r = 0; r < reps; ++r) {
+      clearview();
+      printvisible(world.planets, world.hash);
+      presentframe();
+    }
+  });
+  camera.setworld(60, 200);
+  camera.setwindow(0, 0, 60, 200);
+  setviewport(camera.getview());
+
+  Shot shot(layout, 4, 30, 0);
+  bench("draw.missile", layout.planets.count(), [&](long reps) {
+    for (long r = 0; r < reps; ++r) {
+      Missile shown = shot.getmissile();
+      if (shot.step() != SHOT_FLYING)
+        shot = Shot(layout, 4, 30 + r % 90, 0);
+      erasemissile(shown);
+      printmissile(shot.getmissile());
+      presentframe();
+    }
+  });
+
+  long frames, bytes, writes;
+  displaystats(&frames, &bytes, &writes);
+  endwin();
+  fprintf(stderr, "%ld frames, %.1f bytes and %.3f writes per frame\n",
+          frames, (double)bytes / max(frames, 1L), (double)writes / max(frames, 1L));
+}
+
+static void writejson(ostream & out) {
+  out << "{\n  \"benchmarks\": [\n";
+  for (size_t i = 0; i < results.size(); ++i) {
+    char line[200];
+    snprintf(line, sizeof line, "    {\"name\": \"%s\", \"n\": %d, \"ns_per_op\": %.2f}%s\n",
+             results[i].name.c_str(), results[i].n, results[i].ns, i + 1 < results.size() ? "," : "");
+    out << line;
+  }
+  out << "  ]\n}\n";
+}
+
+// Reads back the results writejson wrote, one benchmark per line
+static vector<BenchResult> readjson(istream & in) {
+  vector<BenchResult> out;
+  string line;
+  while (getline(in, line)) {
+    char name[100];
+    BenchResult result;
+    if (sscanf(line.c_str(), " {\"name\": \"%99[^\"]\", \"n\": %d, \"ns_per_op\": %lf", name, &result.n, &result.ns) == 3) {
+      result.name = name;
+      out.push_back(result);
+    }
+  }
+  return out;
+}
+
+// Prints each benchmark's change from the baseline. Returns how many
+// got slower by more than failpct percent.
+static int compare(const vector<BenchResult> & baseline, double failpct) {
+  int regressions = 0;
+  fprintf(stderr, "\n%-20s %7s %12s %12s %8s\n", "benchmark", "n", "baseline", "now", "change");
+  for (size_t i = 0; i < results.size(); ++i) {
+    for (size_t j = 0; j < baseline.size(); ++j) {
+      if (baseline[j].name != results[i].name || baseline[j].n != results[i].n)
+        continue;
+      double change = 100 * (results[i].ns / baseline[j].ns - 1);
+      bool slower = (change > failpct);
+      regressions += slower;
+      fprintf(stderr, "%-20s %7d %12.1f %12.1f %+7.1f%%%s\n", results[i].name.c_str(), results[i].n,
+              baseline[j].ns, results[i].ns, change, slower ? "  slower" : "");
+    }
+  }
+  return regressions;
+}
+
+int main(int argc, char * argv[]) {
+  const char * outname = NULL;
+  const char * basename = NULL;
+  double failpct = 10;
+  bool draw = true;
+  for (int i = 1; i < argc; ++i) {
+    if (!strcmp(argv[i], "-o") && i + 1 < argc)
+      outname = argv[++i];
+    else if (!strcmp(argv[i], "--baseline") && i + 1 < argc)
+      basename = argv[++i];
+    else if (!strcmp(argv[i], "--fail-over") && i + 1 < argc)
+      failpct = atof(argv[++i]);
+    else if (!strcmp(argv[i], "--min-time") && i + 1 < argc)
+      mintime = atof(argv[++i]) / 1000;
+    else if (!strcmp(argv[i], "--no-draw"))
+      draw = false;
+    else {
+      cerr << "usage: " << argv[0] << " [-o file] [--baseline file] [--fail-over pct]"
+           << " [--min-time ms] [--no-draw]" << endl;
+      return 1;
+    }
+  }
+
+  microbenchmarks();
+  macrobenchmarks();
+  if (draw)
+    drawbenchmarks();
+
+  if (outname) {
+    ofstream out(outname);
+    writejson(out);
+  }
+  else {
+    writejson(cout);
+  }
+
+  if (basename) {
+    ifstream in(basename);
+    if (!in) {
+      cerr << "no baseline in " << basename << ", so nothing was compared; run make bench-baseline to save one" << endl;
+      return 1;
+    }
+    return compare(readjson(in), failpct) > 0 ? 2 : 0;
+  }
+  return 0;
+}
@@ -0,0 +1,162 @@
+/*
+ * bphost
+ *
+ * Hosts many networked games at once. Pairs players in the order they
+ * connect with "battleplanets --connect host:port" and plays each pair
+ * a game with the same settings bpserver takes, on a SessionServer.
+ * Prints how many games are on every few seconds; Ctrl-C stops it.
+ *
+ */
+
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <csignal>
+#include <thread>
+#include <unistd.h>
+#include <sys/resource.h>
+#include "Sim.h"
+#include "Replay.h"
+#include "Scheduler.h"
+#include "Match.h"
+#include "SessionServer.h"
+
+using namespace std;
+
+static SessionServer * server = NULL;
+static volatile sig_atomic_t quitting = 0;
+
+static void onsignal(int) {
+  quitting = 1;
+  server->interrupt();
+}
+
+// Every game holds two sockets, so the default limit of 1024 open
+// files would stop the server at about 500 games
+static void raisefilelimit() {
+  rlimit limit;
+  if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max) {
+    limit.rlim_cur = limit.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &limit);
+  }
+}
+
+int main(int argc, char * argv[]) {
+  if (argc < 2) {
+    cerr << "usage: " << argv[0] << " port [--shards n] [--workers n] [--max-steps n] [--stats secs]"
+         << " [--seed n] [--world lines cols] [--integrator name] [--force-law name] [--tolerance t] [--swept] [--theta t]"
+         << " [--field-grid res] [--salvo n] [--spread deg]" << endl;
+    return 1;
+  }
+  int port = atoi(argv[1]);
+  int nshards = corecount();
+  int nworkers = 2;
+  int every = 5;
+  int maxsteps = 100000;                 // Far longer than any shot that lands
+  uint64_t seed = time(NULL);
+  int nlines = 50, ncols = 160;
+  int salvosize = 0;
+  double spread = 30;
+  bool usegrid = false;
+  Layout layout;                         // Only holds the settings
+  for (int i = 2; i < argc; ++i) {
+    if (!strcmp(argv[i], "--shards") && i + 1 < argc) {
+      nshards = atoi(argv[++i]);
+    }
+    else if (!strcmp(argv[i], "--workers") && i + 1 < argc) {
+      nworkers = atoi(argv[++i]);
+    }
+    else if (!strcmp(argv[i], "--max-steps") && i + 1 < argc) {
+      maxsteps = atoi(argv[++i]);
+    }
+    else if (!strcmp(argv[i], "--stats") && i + 1 < argc) {
+      every = atoi(argv[++i]);
+    }
+    else if (!strcmp(argv[i], "--seed") && i + 1 < argc) {
+      seed = strtoull(argv[++i], NULL, 10);
+    }
+    else if (!strcmp(argv[i], "--world") && i + 2 < argc) {
+      nlines = atoi(argv[++i]);
+      ncols = atoi(argv[++i]);
+    }
+    else if (!strcmp(argv[i], "--integrator") && i + 1 < argc && parseintegrator(argv[i + 1]) >= 0) {
+      layout.integrator = parseintegrator(argv[++i]);
+    }
+    else if (!strcmp(argv[i], "--force-law") && i + 1 < argc && parseforcelaw(argv[i + 1]) >= 0) {
+      layout.forcelaw = parseforcelaw(argv[++i]);
+    }
+    else if (!strcmp(argv[i], "--tolerance") && i + 1 < argc) {
+      layout.tolerance = atof(argv[++i]);
+    }
+    else if (!strcmp(argv[i], "--swept")) {
+      layout.swept = true;
+    }
+    else if (!strcmp(argv[i], "--theta") && i + 1 < argc) {
+      layout.tree.settheta(atof(argv[++i]));
+    }
+    else if (!strcmp(argv[i], "--field-grid") && i + 1 < argc) {
+      usegrid = true;
+      layout.grid.setresolution(atoi(argv[++i]));
+    }
+    else if (!strcmp(argv[i], "--salvo") && i + 1 < argc) {
+      salvosize = atoi(argv[++i]);
+    }
+    else if (!strcmp(argv[i], "--spread") && i + 1 < argc) {
+      spread = atof(argv[++i]);
+    }
+    else {
+      cerr << "unknown option " << argv[i] << endl;
+      return 1;
+    }
+  }
+  if (nshards < 1)
+    nshards = 1;
+  if (nworkers < 1)
+    nworkers = 1;
+  if (maxsteps < MAXSTEPS)
+    maxsteps = MAXSTEPS;
+  if (every < 1)
+    every = 1;
+  if (salvosize > 1 && layout.integrator != INTEGRATE_EULER) {
+    cerr << "--salvo flies Euler steps; it can't be used with --integrator verlet or rk45" << endl;
+    return 1;
+  }
+
+  raisefilelimit();
+  ReplayHeader game = replayheader(layout, seed, nlines, ncols, usegrid, salvosize, spread);
+  game.maxsteps = maxsteps;              // Sent in the hello, so the players stop their shots there too
+  if (!validheader(game)) {
+    cerr << "the field size, salvo, grid resolution, tolerance, theta or spread is out of range" << endl;
+    return 1;
+  }
+  if (!fieldplayable(game)) {
+    cerr << "a " << nlines << " by " << ncols << " field is too small for the players' planets" << endl;
+    return 1;
+  }
+  server = new SessionServer(game, nshards, nworkers);
+  if (!server->listen(port)) {
+    perror("listen");
+    return 1;
+  }
+  signal(SIGINT, onsignal);
+  signal(SIGTERM, onsignal);
+  cout << "hosting on port " << port << " with " << nshards << " shards of "
+       << nworkers << " workers" << endl;
+
+  thread acceptor(&SessionServer::run, server);
+  long lastturns = 0;
+  while (!quitting) {
+    for (int s = 0; s < every && !quitting; ++s)
+      sleep(1);
+    ServerStats stats = server->getstats();
+    cout << "games " << stats.active << "  finished " << stats.matches
+         << "  turns " << stats.turns << "  turns/s " << (stats.turns - lastturns) / every << endl;
+    lastturns = stats.turns;
+  }
+  acceptor.join();
+  server->stop();
+  delete server;
+  return 0;
+}
@@ -0,0 +1,222 @@
+/*
+ * bpload
+ *
+ * Load generator for bpserver and bphost. Keeps --concurrency games
+ * going at once, each as two connections that play like
+ * "battleplanets --connect" would, firing random shots until the game
+ * has had --turns turns and then quitting, and starts another game
+ * whenever one ends until --matches have been played. Runs in one
+ * thread on epoll, so it can hold thousands of connections.
+ *
+ * Reports games and turns per second, and the time from sending a
+ * turn to getting its result back.
+ *
+ */
+
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <chrono>
+#include <vector>
+#include <algorithm>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/resource.h>
+#include "Replay.h"
+#include "Match.h"
+#include "Net.h"
+
+using namespace std;
+
+typedef chrono::steady_clock Clock;
+
+// One player. Pairs are whatever the server makes of the order they
+// connect in, so each connection plays on its own and only needs to
+// know whose turn it is.
+struct Player {
+  int fd;                       // -1 once its game is over
+  int me;                       // Which player, from the hello
+  bool started;                 // Hello read
+  int turns;                    // Results seen
+  int inlen;
+  char in[sizeof(NetHello)];
+  Clock::time_point sent;       // When our turn went, if one is waiting
+  bool waiting;
+};
+
+static uint64_t randstate = 88172645463325252ULL;
+
+static double uniform(double lo, double hi) {
+  randstate ^= randstate << 13;
+  randstate ^= randstate >> 7;
+  randstate ^= randstate << 17;
+  return lo + (hi - lo) * (randstate >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static bool connectplayer(Player & p, const char * host, int port, int epfd, int slot) {
+  p = Player();
+  p.fd = netconnect(host, port);
+  if (p.fd < 0)
+    return false;
+  fcntl(p.fd, F_SETFL, fcntl(p.fd, F_GETFL) | O_NONBLOCK);
+  epoll_event ev;
+  ev.events = EPOLLIN;
+  ev.data.u32 = slot;
+  epoll_ctl(epfd, EPOLL_CTL_ADD, p.fd, &ev);
+  return true;
+}
+
+// Fires a shot, or quits once the game is long enough. The messages
+// are small enough that the socket always takes them whole.
+static bool move(Player & p, int maxturns) {
+  NetTurn turn;
+  memset(&turn, 0, sizeof(turn));
+  turn.action = (p.turns >= maxturns ? REPLAY_QUIT : REPLAY_FIRE);
+  turn.speed = uniform(1, 10);
+  turn.angle = uniform(0, 360);
+  p.sent = Clock::now();
+  p.waiting = true;
+  return send(p.fd, &turn, sizeof(turn), MSG_NOSIGNAL) == (ssize_t)sizeof(turn);
+}
+
+static double percentile(vector<double> & v, double q) {
+  if (v.empty())
+    return 0;
+  size_t k = min(v.size() - 1, (size_t)(q * v.size()));
+  nth_element(v.begin(), v.begin() + k, v.end());
+  return v[k];
+}
+
+int main(int argc, char * argv[]) {
+  const char * colon = (argc > 1 ? strrchr(argv[1], ':') : NULL);
+  if (!colon) {
+    cerr << "usage: " << argv[0] << " host:port [--matches n] [--concurrency n] [--turns n]" << endl;
+    return 1;
+  }
+  string host(argv[1], colon - argv[1]);
+  int port = atoi(colon + 1);
+  long matches = 100;
+  int concurrency = 10;
+  int maxturns = 10;
+  for (int i = 2; i < argc; ++i) {
+    if (!strcmp(argv[i], "--matches") && i + 1 < argc) {
+      matches = atol(argv[++i]);
+    }
+    else if (!strcmp(argv[i], "--concurrency") && i + 1 < argc) {
+      concurrency = atoi(argv[++i]);
+    }
+    else if (!strcmp(argv[i], "--turns") && i + 1 < argc) {
+      maxturns = atoi(argv[++i]);
+    }
+    else {
+      cerr << "unknown option " << argv[i] << endl;
+      return 1;
+    }
+  }
+  if (concurrency > matches)
+    concurrency = matches;
+
+  rlimit limit;
+  if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max) {
+    limit.rlim_cur = limit.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &limit);
+  }
+
+  int epfd = epoll_create1(0);
+  vector<Player> players(2 * concurrency);
+  long started = 0, ended = 0, turns = 0, dropped = 0;   // ended counts players
+  vector<int> spare;                        // Slots of players whose games are over
+  vector<double> latency;                   // Milliseconds
+  Clock::time_point start = Clock::now();
+  for (int k = 0; k < 2 * concurrency; ++k) {
+    if (!connectplayer(players[k], host.c_str(), port, epfd, k)) {
+      perror("connect");
+      return 1;
+    }
+  }
+  started = concurrency;
+  long open = 2 * concurrency;
+
+  epoll_event events[256];
+  while (open > 0) {
+    int n = epoll_wait(epfd, events, 256, -1);
+    if (n < 0 && errno != EINTR)
+      break;
+    for (int e = 0; e < n; ++e) {
+      int slot = events[e].data.u32;
+      Player & p = players[slot];
+      if (p.fd < 0)
+        continue;                   // Closed earlier in this batch
+      int want = (p.started ? sizeof(TurnResult) : sizeof(NetHello));
+      ssize_t got = recv(p.fd, p.in + p.inlen, want - p.inlen, 0);
+      if (got < 0 && (errno == EAGAIN || errno == EINTR))
+        continue;
+      bool over = (got <= 0);
+      if (!over) {
+        p.inlen += got;
+        if (p.inlen < want)
+          continue;
+        p.inlen = 0;
+      }
+      int mover = -1;
+      if (!over && !p.started) {
+        NetHello hello;
+        memcpy(&hello, p.in, sizeof(hello));
+        p.started = true;
+        p.me = hello.player;
+        mover = 0;
+      }
+      else if (!over) {
+        TurnResult result;
+        memcpy(&result, p.in, sizeof(result));
+        ++p.turns;
+        if (p.waiting && result.action == REPLAY_FIRE) {
+          latency.push_back(chrono::duration<double, milli>(Clock::now() - p.sent).count());
+          ++turns;
+        }
+        p.waiting = false;
+        over = (result.action == REPLAY_QUIT);
+        mover = !result.player;
+      }
+      if (!over && mover == p.me && !move(p, maxturns))
+        over = true;
+      if (!over)
+        continue;
+
+      // Game over for this player. Once two places are free they go
+      // to a new game, until there have been enough.
+      if (got <= 0)
+        ++dropped;
+      close(p.fd);
+      p.fd = -1;
+      spare.push_back(slot);
+      --open;
+      ++ended;
+      if (spare.size() >= 2 && started < matches) {
+        ++started;
+        for (int k = 0; k < 2; ++k) {
+          if (!connectplayer(players[spare.back()], host.c_str(), port, epfd, spare.back())) {
+            perror("connect");
+            return 1;
+          }
+          spare.pop_back();
+          ++open;
+        }
+      }
+    }
+  }
+  double elapsed = chrono::duration<double>(Clock::now() - start).count();
+  close(epfd);
+
+  cout << "games " << ended / 2 << "  turns " << turns << "  in " << elapsed << " s" << endl;
+  cout << "games/s " << ended / 2 / elapsed << "  turns/s " << turns / elapsed << endl;
+  cout << "turn latency p50 " << percentile(latency, 0.5) << " ms  p99 " << percentile(latency, 0.99)
+       << " ms  max " << percentile(latency, 1) << " ms" << endl;
+  if (dropped)
+    cout << "connections dropped by the server " << dropped << endl;
+  return 0;
+}
@@ -10,131 +10,429 @@
  */
 
 #include <iostream>
+#include <string>
+#include <vector>
 #include <ncurses.h>
 #include <cstdlib>
 #include <cstring>
 #include <ctime>
 #include <cmath>
-#include "Body.h"
+#include <unistd.h>
+#include <poll.h>
+#include "Sim.h"
+#include "Display.h"
+#include "AI.h"
+#include "FrameTimer.h"
+#include "Profile.h"
+#include "Replay.h"
+#include "Trajectory.h"
+#include "Salvo.h"
+#include "Camera.h"
+#include "Net.h"
 
 using namespace std;
 
 // Helper functions for the main game program
-void wait(int);                                             // Allows pausing for animations
-Body * checkcollision(const Missile*, Body *);              // Checks every body on the screen. Returns a pointer to the body collided with
-void setupinterface(int, int);                              // Prints the main interface components of the game using ncurses functions
-int inputparam(char [], char [], int, int);                 // The main user control function. Returns a value based on the keypress
-void arrangeplanets(Body *, int, int, int);                 // Creates a random arrangement of planets so that none of them overlap, etc.
-bool checkSides(Missile*, int, int);                        // Returns true if the projectile has reached the edge of the screen
-Body * fireproj(Missile*, Body * head, bool, int, int);     // Packages up some other functions that combine to move the projectile across the screen
+void setupinterface(int, int, bool);                        // Prints the main interface components of the game using ncurses functions
+int inputparam(char [], char [], int, int, const Layout &, Camera &, bool, int = -1);  // The main user control function. Returns a value based on the keypress
+void drawboard(const Layout &, const Camera &, bool);       // Draws the planets and players' marks that are in view
+int fireproj(const Layout &, bool, double, double, FrameTimer &, Camera &, int);  // Animates a shot from the current player's planet. Returns the index of the body hit
+int firesalvo(Salvo &, vector<int> &, bool, double, double, FrameTimer &, int, double, int);  // Same for a salvo. Returns how many hit the other player's planet
 void printscore(int *, int, int);                           // Prints player scores on the screen and updates them
 char* itoa(int, char*, int);                                // Used in printscore, converts an int to a char array
+bool checkreplay(const Replay &, const int *);              // Compares a replayed game's score with the recording's
+void printwaiting(bool, int, int);                          // Tells a networked player whose turn it is
+
+int main(int argc, char * argv[]) {
+  // Command line options. --bh-check compares the Barnes-Hut
+  // approximation against the exact sum for a field of the given
+  // size and exits without starting the game. --field-grid bakes
+  // each layout's gravity into a grid with res samples per cell.
+  // --ai makes player 2 a computer that takes up to ms per turn.
+  // --stats reports frames drawn and bytes sent to the terminal.
+  // --fps caps how often a shot is redrawn and --max-speed skips
+  // the animation altogether. --seed picks the first layout; each
+  // new planet system uses the next seed. --integrator picks how
+  // missiles are moved, with --tolerance for rk45, and --force-law
+  // how the planets pull (newton, softened or inverse). --swept checks
+  // the whole path of each step for hits rather than just its end.
+  // --record saves the game to a file, and --replay plays one back,
+  // at --replay-speed times real time, or headless as fast as it can
+  // if that is 0, checking the final score against the recording.
+  // --trajectory writes every step of every shot to a file.
+  // --salvo fires n missiles a shot, their angles spread over
+  // --spread degrees around the one entered. --world plays on a
+  // field of the given size rather than the terminal's, seen through
+  // a window that follows each shot and scrolls with h, j, k and l.
+  // --connect joins a game refereed by bpserver at host:port, which
+  // picks the settings.
+  bool bhcheckmode = false;
+  const char * recordname = NULL;
+  const char * replayname = NULL;
+  const char * trajname = NULL;
+  const char * connectname = NULL;
+  int salvosize = 0;
+  double spread = 30;
+  int maxsteps = INT_MAX;              // A shot flies until it lands, unless the server or recording says otherwise
+  double replayspeed = 1;
+  uint64_t seed = time(NULL);
+  FrameTimer timer(0.1, 30);           // A physics step every 100 ms, as the game has always run
+  bool stats = false;
+  bool usegrid = false;
+  int aibudget = -1;
+  int checklines = 0, checkcols = 0;
+  int worldlines = 0, worldcols = 0;
+  Layout layout;
+  PROFILE_START(getenv("BP_PROFILE_FILE"));   // Does nothing unless built with PROFILE=1
+  for (int i = 1; i < argc; ++i) {
+    if (!strcmp(argv[i], "--theta") && i + 1 < argc) {
+      layout.tree.settheta(atof(argv[++i]));
+    }
+    else if (!strcmp(argv[i], "--field-grid") && i + 1 < argc) {
+      usegrid = true;
+      layout.grid.setresolution(atoi(argv[++i]));
+    }
+    else if (!strcmp(argv[i], "--seed") && i + 1 < argc) {
+      seed = strtoull(argv[++i], NULL, 10);
+    }
+    else if (!strcmp(argv[i], "--integrator") && i + 1 < argc && parseintegrator(argv[i + 1]) >= 0) {
+      layout.integrator = parseintegrator(argv[++i]);
+    }
+    else if (!strcmp(argv[i], "--force-law") && i + 1 < argc && parseforcelaw(argv[i + 1]) >= 0) {
+      layout.forcelaw = parseforcelaw(argv[++i]);
+    }
+    else if (!strcmp(argv[i], "--tolerance") && i + 1 < argc) {
+      layout.tolerance = atof(argv[++i]);
+    }
+    else if (!strcmp(argv[i], "--swept")) {
+      layout.swept = true;
+    }
+    else if (!strcmp(argv[i], "--fps") && i + 1 < argc) {
+      timer.setmaxfps(atof(argv[++i]));
+    }
+    else if (!strcmp(argv[i], "--max-speed")) {
+      timer.setmaxspeed(true);
+    }
+    else if (!strcmp(argv[i], "--stats")) {
+      stats = true;
+    }
+    else if (!strcmp(argv[i], "--ai") && i + 1 < argc) {
+      aibudget = atoi(argv[++i]);
+    }
+    else if (!strcmp(argv[i], "--record") && i + 1 < argc) {
+      recordname = argv[++i];
+    }
+    else if (!strcmp(argv[i], "--replay") && i + 1 < argc) {
+      replayname = argv[++i];
+    }
+    else if (!strcmp(argv[i], "--trajectory") && i + 1 < argc) {
+      trajname = argv[++i];
+    }
+    else if (!strcmp(argv[i], "--salvo") && i + 1 < argc) {
+      salvosize = atoi(argv[++i]);
+    }
+    else if (!strcmp(argv[i], "--spread") && i + 1 < argc) {
+      spread = atof(argv[++i]);
+    }
+    else if (!strcmp(argv[i], "--replay-speed") && i + 1 < argc) {
+      replayspeed = atof(argv[++i]);
+      if (!isfinite(replayspeed) || replayspeed < 0 || (replayspeed > 0 && replayspeed < 1e-6)) {
+        cerr << "--replay-speed must be 0, for a headless check, or a positive speed of at least 1e-6" << endl;
+        return 1;
+      }
+    }
+    else if (!strcmp(argv[i], "--connect") && i + 1 < argc) {
+      connectname = argv[++i];
+    }
+    else if (!strcmp(argv[i], "--world") && i + 2 < argc) {
+      worldlines = atoi(argv[++i]);
+      worldcols = atoi(argv[++i]);
+    }
+    else if (!strcmp(argv[i], "--bh-check") && i + 2 < argc) {
+      bhcheckmode = true;
+      checklines = atoi(argv[++i]);
+      checkcols = atoi(argv[++i]);
+    }
+    else {
+      cerr << "usage: " << argv[0] << " [--seed n] [--theta t] [--field-grid res] [--integrator euler|verlet|rk45]"
+           << " [--tolerance t] [--force-law newton|softened|inverse] [--swept] [--ai ms] [--fps n] [--max-speed]"
+           << " [--stats] [--record file] [--replay file] [--replay-speed x] [--trajectory file]"
+           << " [--salvo n] [--spread deg] [--world lines cols] [--connect host:port]"
+           << " [--bh-check lines cols]" << endl;
+      return 1;
+    }
+  }
+
+  if (salvosize > 1 && layout.integrator != INTEGRATE_EULER) {
+    cerr << "--salvo flies Euler steps; it can't be used with --integrator verlet or rk45" << endl;
+    return 1;
+  }
+  if (worldlines > MAXFIELD || worldcols > MAXFIELD) {
+    cerr << "--world can be at most " << MAXFIELD << " by " << MAXFIELD << endl;
+    return 1;
+  }
+
+  if (bhcheckmode) {
+    if (checklines <= 0 || checkcols <= 0) {
+      cerr << "--bh-check needs a field at least 1 by 1" << endl;
+      return 1;
+    }
+    arrangeplanets(layout, planetcount(checklines, checkcols), checklines, checkcols, seed);
+    double maxerr;
+    int taken;
+    double rms = bhcheck(layout.planets, layout.tree, 1000, checklines, checkcols, layout.forcelaw, seed, &maxerr, &taken);
+    cout << "bodies " << layout.planets.count() << "  nodes " << layout.tree.nodecount()
+         << "  theta " << layout.tree.gettheta() << endl;
+    if (taken < 1000)
+      cout << "only " << taken << " of 1000 sample points were outside the planets" << endl;
+    cout << "relative force error  rms " << rms << "  max " << maxerr << endl;
+    return 0;
+  }
+
+  Replay replay;
+  size_t nextturn = 0;
+  if (replayname) {
+    if (!readreplay(replayname, replay)) {
+      cerr << "can't read replay " << replayname << endl;
+      return 1;
+    }
+    if (replayspeed <= 0) {
+      int replayscore[2];
+      int shots = playreplay(replay, replayscore);
+      cout << "shots " << shots << "  score " << replayscore[0] << " - " << replayscore[1] << endl;
+      return checkreplay(replay, replayscore) ? 0 : 1;
+    }
+    replaysettings(replay.header, layout);    // The game's settings, not the command line's
+    seed = replay.header.seed;
+    usegrid = (replay.header.gridres > 0);
+    salvosize = replay.header.salvo;
+    spread = replay.header.spread;
+    maxsteps = shotsteps(replay.header);
+    aibudget = -1;                            // The computer's shots are in the recording
+    timer.setstep(0.1 / replayspeed);
+  }
+
+  // A networked game: the server sends the settings and says which
+  // player this is, and from then on every turn's result
+  int netfd = -1;
+  int netplayer = 0;
+  ReplayHeader netgame;
+  if (connectname) {
+    string host = connectname;
+    size_t colon = host.rfind(':');
+    int port = (colon == string::npos ? 0 : atoi(host.c_str() + colon + 1));
+    host = host.substr(0, colon);
+    netfd = netconnect(host.c_str(), port);
+    if (netfd < 0) {
+      cerr << "can't connect to " << connectname << endl;
+      return 1;
+    }
+    cout << "waiting for the other player" << endl;
+    if (!recvhello(netfd, &netplayer, &netgame)) {
+      cerr << connectname << " isn't a battleplanets server of this version" << endl;
+      return 1;
+    }
+    replaysettings(netgame, layout);
+    seed = netgame.seed;
+    usegrid = (netgame.gridres > 0);
+    salvosize = netgame.salvo;
+    spread = netgame.spread;
+    maxsteps = shotsteps(netgame);
+    aibudget = -1;
+  }
+  else if (!replayname && salvosize > 1) {
+    maxsteps = MAXSTEPS;                      // So a missile caught in an orbit can't hold up the game
+  }
 
-int main() {
   // This block of code initiates some relevant features of
   // ncurses.
-  initscr();
+  startdisplay();
   cbreak();
   noecho();
   keypad(stdscr, TRUE);
   int nlines, ncols;
   getmaxyx(stdscr, nlines, ncols);        // gets the dimensions of the terminal window
+  if (worldlines <= 0 || worldcols <= 0) {
+    worldlines = nlines;                  // The field is the terminal, as it has always been
+    worldcols = ncols;
+  }
+  if (replayname) {
+    worldlines = replay.header.nlines;    // The layouts depend on the size the game was played at
+    worldcols = replay.header.ncols;
+  }
+  if (netfd >= 0) {
+    worldlines = netgame.nlines;          // The server's field, whatever size this terminal is
+    worldcols = netgame.ncols;
+  }
+  Camera camera;
+  camera.setworld(worldlines, worldcols);
+  if (worldlines != nlines || worldcols != ncols)
+    camera.setwindow(3, 0, nlines - 7, ncols);   // Between the title and the prompts
+  else
+    camera.setwindow(0, 0, nlines, ncols);
 
   // Creates a random group of planets to display to the screen
-  int area = nlines * ncols;
-  int num = area / 700;                // Number of planets. Scales to terminal size.
-  Body planets[num];
-  arrangeplanets(planets, num, nlines, ncols);
-  Body * head = &planets[0];
-
-  // Link the Bodies. Necessary for proper functioning of
-  // the physics engine
-  for (int i = 0; i < num - 2; ++i) {
-    planets[i].setnext(&planets[i + 1]);
+  int num = planetcount(worldlines, worldcols);   // Number of planets. Scales to the size of the field.
+  if (arrangeplanets(layout, num, worldlines, worldcols, seed).placed < 2) {
+    endwin();
+    cerr << "a " << worldlines << " by " << worldcols << " field is too small for the players' planets" << endl;
+    return 1;
+  }
+  const BodyStore & planets = layout.planets;
+  if (usegrid)
+    layout.grid.buildasync(planets, worldlines, worldcols, layout.forcelaw);
+
+  TrajectorySink trajectory;
+  if (trajname) {
+    if (!trajectory.open(trajname, seed)) {
+      endwin();
+      cerr << "can't write " << trajname << endl;
+      return 1;
+    }
+  }
+
+  ReplayWriter recorder;
+  ReplayHeader recording = replayheader(layout, seed, worldlines, worldcols, usegrid, salvosize, spread);
+  recording.maxsteps = (maxsteps < INT_MAX ? maxsteps : 0);   // A replay stops its shots where this game did
+  if (recordname && !validheader(recording)) {
+    endwin();
+    cerr << "the field size, salvo, grid resolution, tolerance, theta or spread is out of range for a recording" << endl;
+    return 1;
   }
+  if (recordname && !recorder.open(recordname, recording)) {
+    endwin();
+    cerr << "can't write " << recordname << endl;
+    return 1;
+  }
+
+  Salvo salvo(layout);                 // Kept for the whole game, so salvos after the first reuse its memory
+  vector<int> salvoshown;              // Cells the salvo was drawn in last frame, likewise
 
   //Initialize player 1 and the score of each to 0. 
   bool player = 0;
   int ctrl = 1;
   int score[2] = {0, 0};
+  TurnResult result = TurnResult();       // The server's word on the last turn
+  bool netlost = false;
+  int desyncs = 0;
   // Main program loop
   while (ctrl) {
     if (ctrl == 2) {
-      for (int i = 0; i < num; ++i) {       // Erase the current set of planets
-        planets[i].erasebody();
-      }
-      arrangeplanets(planets, num, nlines, ncols);  // Gets a new planet arrangement, prints it, links the list
-      head = &planets[0];
-      for (int i = 0; i < num - 2; ++i) {
-        planets[i].setnext(&planets[i + 1]);
-      }
-    }
-    setupinterface(nlines, ncols);        // Repair UI elements that have been damaged
-    for (int i = 0; i < num; ++i) {       // Repair planets that have been damaged
-      planets[i].printbody();
+      erasevisible(planets, layout.hash);   // Erase the current set of planets
+      arrangeplanets(layout, num, worldlines, worldcols, ++seed);   // Gets a new planet arrangement
+      if (usegrid)
+        layout.grid.buildasync(planets, worldlines, worldcols, layout.forcelaw);    // Bake the new field while the players aim
     }
-    wmove(stdscr, planets[0].gety(), planets[0].getx());    // Mark the player's planet
-    player ? addch('1') : addch('1' | A_STANDOUT);          // Highlight if current player
-    wmove(stdscr, planets[1].gety(), planets[1].getx());    // Mark the target planet
-    player ? addch('2' | A_STANDOUT) : addch('2');          // Highlight if current player
+    camera.center(planets.getx(player ? 1 : 0), planets.gety(player ? 1 : 0));   // Start the turn looking at the shooter
+    setupinterface(nlines, ncols, camera.scrolls());   // Repair UI elements that have been damaged
+    drawboard(layout, camera, player);    // Repair planets that have been damaged
     printscore(score, nlines, ncols);
-    wrefresh(stdscr);
+    presentframe();                       // The whole board goes out at once
 
-    Body * collided = NULL;
+    int collided = -1;
     // Get user inputs for angle and speed
-    char vbuf[3];
-    char vthetabuf[3];
-    curs_set(1);
-    ctrl = inputparam(vbuf, vthetabuf, nlines, ncols);            // Get user input for the projectile
-    curs_set(0);
+    char vbuf[3] = "";
+    char vthetabuf[3] = "";
+    double v1 = 0, vtheta = 0;
+    if (replayname) {                                             // Inputs come from the recording
+      if (nextturn < replay.turns.size()) {
+        const ReplayTurn & turn = replay.turns[nextturn++];
+        ctrl = turn.action;
+        v1 = turn.speed;
+        vtheta = turn.angle;
+      }
+      else {
+        ctrl = 0;
+      }
+    }
+    else if (netfd >= 0) {                                        // The server referees
+      if (player == netplayer) {
+        curs_set(1);
+        ctrl = inputparam(vbuf, vthetabuf, nlines, ncols, layout, camera, player, netfd);
+        curs_set(0);
+        if (ctrl != 4)                                            // 4: the server ended the game first
+          sendturn(netfd, ctrl, atof(vbuf), atof(vthetabuf));
+      }
+      printwaiting(player == netplayer, nlines, ncols);
+      if (recvresult(netfd, &result) && result.player == player) {
+        ctrl = result.action;                                     // What the server played, not what was typed
+        v1 = result.speed;
+        vtheta = result.angle;
+      }
+      else {
+        ctrl = 0;
+        netlost = true;
+      }
+    }
+    else if (player && aibudget >= 0) {                           // The computer plays player 2
+      AIShot aim = aimshot(layout, 1, aibudget);
+      v1 = aim.speed;
+      vtheta = aim.angle;
+      ctrl = 3;
+    }
+    else {
+      curs_set(1);
+      ctrl = inputparam(vbuf, vthetabuf, nlines, ncols, layout, camera, player);  // Get user input for the projectile
+      curs_set(0);
+      v1 = atof(vbuf);
+      vtheta = atof(vthetabuf);
+    }
+    if (ctrl == 2 || ctrl == 3)
+      recorder.turn(ctrl, v1, vtheta);
     if (ctrl == 3) {                                              // 'Fire' signal recieved
-      double v1 = atof(vbuf);
-      double vtheta = atof(vthetabuf);
-      Body * start = (player ? &planets[1] : &planets[0]);        // The missile starts at the current player's planet
-      Missile * missile1 = new Missile(start, v1, vtheta, 9);
-      collided = fireproj(missile1, head, player, nlines, ncols); // If the missile collided with something, return the pointer to that object
-      if (collided == (player ? &planets[0] : &planets[1])) {     // Did they hit the other player's planet?
-        ++score[player];
+      if (usegrid && (recordname || replayname || netfd >= 0))
+        layout.grid.wait();                                       // Recorded shots can't depend on how far the bake got
+      if (salvosize > 1) {
+        int hits = firesalvo(salvo, salvoshown, player, v1, vtheta, timer, salvosize, spread, maxsteps);
+        if (hits > 0)
+          ++score[player];                                        // One point however many of the salvo hit
+        desyncs += (netfd >= 0 && hits != result.hits);
+      }
+      else {
+        layout.trajectory = (trajname ? &trajectory : NULL);      // Only shots actually fired, not the computer's trial ones
+        collided = fireproj(layout, player, v1, vtheta, timer, camera, maxsteps);    // If the missile collided with something, return the index of that body
+        layout.trajectory = NULL;
+        if (collided == (player ? 0 : 1)) {                       // Did they hit the other player's planet?
+          ++score[player];
+        }
+        desyncs += (netfd >= 0 && collided != result.hit);
       }
       player = !player;                                           // Switch players after every launch
-      delete missile1;
+    }
+    if (netfd >= 0 && !netlost) {
+      score[0] = result.score[0];                                 // The server's scores stand
+      score[1] = result.score[1];
     }
  }
 
+  recorder.finish(score);
+  trajectory.close();
+
+  long frames, bytes, writes;
+  displaystats(&frames, &bytes, &writes);
   endwin();
 
-  return 0;
-}
+  if (replayname && !checkreplay(replay, score))
+    return 1;
 
-//structure of wait program taken from ubuntuforums.org user
-//OVERPOWER8
-void wait(int mil) {
-  clock_t endwait;
-  endwait = clock() + mil * CLOCKS_PER_SEC / 1000;
-  while (clock() < endwait) {}
-}
+  if (netfd >= 0) {
+    close(netfd);
+    if (netlost)
+      cout << "lost the connection to the server" << endl;
+    if (desyncs)
+      cout << desyncs << " shots flew differently here than on the server; the scores are the server's" << endl;
+    cout << "final score " << score[0] << " - " << score[1] << endl;
+  }
 
-Body * checkcollision(const Missile* proj, Body * head) {         // Checks whether the projectile is within a certain distance of the planet center
-  Body * iterator = head;                                         // Checks the whole linked list
-  while (iterator) {
-    int rad = iterator->getsize() / 2;                            // body.size is the diameter, in number of lines; divide to get the radius
-    double projx = proj->getx();
-    double projy = proj->gety();
-    double bodyx = iterator->getx();
-    double bodyy = iterator->gety();
-    double xdiff = abs(projx - bodyx) / 2;                        // chars are twice as tall as they are wide;
-    double ydiff = abs(projy - bodyy);                            // dividing by two evens this up in the distance calculation.
-    double dist = sqrt(pow(xdiff,2) + pow(ydiff, 2));
-    if (dist < rad) {
-      break;
-    }
-    iterator = iterator->getnext();
+  if (stats) {
+    cout << "frames " << frames << "  bytes " << bytes << "  writes " << writes
+         << "  bytes/frame " << (frames ? bytes / frames : 0) << endl;
   }
-  // Returns a pointer to the body collided with
-  return iterator;                                               // If there hasn't been a collision, the null pointer is returned.
+
+  return 0;
 }
 
-void setupinterface(int nlines, int ncols) {
+void setupinterface(int nlines, int ncols, bool scrolling) {
   // Set up game interface
   // First, a header
   char title[] = "BATTLE PLANETS BETA -- BY C.P.L.U.S.P.L.U.S";
@@ -150,6 +448,11 @@ void setupinterface(int nlines, int ncols) {
   char helptext[] = "<i>: Input a number    <f>: Fire projectile    <n>: New planet system    <q>: Quit";
   wmove(stdscr, nlines - 1, (ncols / 2) - (strlen(helptext) / 2));
   addstr(helptext);
+  if (scrolling) {
+    char scrolltext[] = "<h/j/k/l>: Scroll the view";
+    wmove(stdscr, nlines - 2, (ncols / 2) - (strlen(scrolltext) / 2));
+    addstr(scrolltext);
+  }
   int space = 5;                                                                               // The space between the two prompts
   int promptcursor = (ncols / 2) - ((strlen(promptangle) + strlen(promptspeed) + space) / 2);  // The prompt will be centered at the bottom of the screen
   wmove(stdscr, nlines - 3, promptcursor);
@@ -157,10 +460,9 @@ void setupinterface(int nlines, int ncols) {
   wmove(stdscr, nlines - 3, promptcursor + strlen(promptangle) + space);   // Move the cursor to the beginning of the next string
   addstr(promptspeed);
   wmove(stdscr, nlines - 3, promptcursor + strlen(promptangle));           // Move cursor to first input position
-  wrefresh(stdscr);
 }
 
-int inputparam(char vbuf[3], char vthetabuf[3], int nlines, int ncols) {
+int inputparam(char vbuf[3], char vthetabuf[3], int nlines, int ncols, const Layout & layout, Camera & camera, bool player, int watchfd) {
   // Get user input
   bool userinput = FALSE;
   int pos = 0;
@@ -181,7 +483,17 @@ int inputparam(char vbuf[3], char vthetabuf[3], int nlines, int ncols) {
   wmove(stdscr, nlines - 3, promptcursor + strlen(promptangle));
   wrefresh(stdscr);
   while(!userinput) {
-    ch = getch();
+    if (watchfd >= 0) {                                                                         // Networked: the server only speaks first to end the game
+      timeout(100);
+      ch = getch();
+      timeout(-1);
+      pollfd server = {watchfd, POLLIN, 0};
+      if (ch == ERR && poll(&server, 1, 0) > 0)
+        return 4;
+    }
+    else {
+      ch = getch();
+    }
     switch (ch) {
       case 'i':                                                                                  // 'i' for input. Inspired by vim.
         if (pos == 0) {
@@ -217,97 +529,149 @@ int inputparam(char vbuf[3], char vthetabuf[3], int nlines, int ncols) {
       case 'n':
         return 2;
         break;
+      case 'h':                                                                                 // Scroll the view, vim style
+      case 'j':
+      case 'k':
+      case 'l':
+        if (camera.scrolls()) {
+          const Viewport & view = camera.getview();
+          int dx = (ch == 'h' ? -view.cols / 4 : (ch == 'l' ? view.cols / 4 : 0));
+          int dy = (ch == 'k' ? -view.lines / 4 : (ch == 'j' ? view.lines / 4 : 0));
+          int y, x;
+          getyx(stdscr, y, x);                                                                  // Put the cursor back where it was after redrawing
+          camera.pan(dx, dy);
+          drawboard(layout, camera, player);
+          wmove(stdscr, y, x);
+        }
+        break;
     }
     wrefresh(stdscr);
   }
   return 1;
 }
 
-// Arranges the selected number of planets on the screen, at
-// pseudo-random locations. Ensures they do not overlap or
-// go off the edge of the screen.
-void arrangeplanets(Body * planets, int num, int nlines, int ncols) {
-  srand(time(NULL));
-  int minlines = 3;                           // Bounaries take into account the UI elements
-  int maxlines = nlines - 4;
-  int linesrange = maxlines - minlines;
-  int mincols = 0;
-  int maxcols = ncols;
-  int colsrange = maxcols - mincols;
-  int sizes[5] = {3, 4, 5, 6, 9};
-  int s[num];             // Stores the sizes of the bodes;
-  double x[num], y[num];  // Stores the locations of the bodies;
-  s[0] = 9;
-  s[1] = 9;                         // There must be at least two planets of size 9
-  for (int i = 2; i < num; ++i) {   // The rest of the sizes may be random (one of the five possible sizes)
-    s[i] = rand() % 5;
-    s[i] = sizes[s[i]];             // Must be one of the possible sizes
-  }
+// Only the planets in the camera's window are drawn, found through
+// the collision index, so a big field costs no more to draw than one
+// the size of the terminal
+void drawboard(const Layout & layout, const Camera & camera, bool player) {
+  const BodyStore & planets = layout.planets;
+  setviewport(camera.getview());
+  if (camera.scrolls())
+    clearview();                                            // Whatever was in the window before it moved
+  printvisible(planets, layout.hash);
+  printmarker(planets.getx(0), planets.gety(0), '1', !player);   // Mark the players' planets, highlighting
+  printmarker(planets.getx(1), planets.gety(1), '2', player);    // the current player
+}
 
-  // Place the first planet in a random location on the screen; can't go off the screen
-  // x values are double y values for the same distance, hence the differing algorithms
-  x[0] = rand() % (colsrange - 2 * s[0]) + (mincols + s[0]);   
-  y[0] = rand() % (linesrange - s[0]) + (minlines + s[0] / 2);
-  for (int i = 1; i < num; ++i) {
-  bool clear = FALSE;             // Flag is true if the new planet doesn't overlap with any of the previous ones
-    while (!clear) {
-      x[i] = rand() % (colsrange - 2 * s[i]) + (mincols + s[i]); 
-      y[i] = rand() % (linesrange - s[i]) + (minlines + s[i] / 2);
-      clear = TRUE;
-      for (int j = i - 1; j >= 0; --j) {
-        double dist = sqrt(pow((x[i] - x[j]) / 2, 2) + pow(y[i] - y[j], 2));    // Halve the x number to get distance
-        double mindist = (double)s[i] / 2 + (double)s[j] / 2;
-        if (dist < mindist) {
-          clear = FALSE;
-        }
+// Abstracts away the functions needed to fire the missile.
+// The simulation core moves the missile; this just draws it.
+// The timer decides when the physics steps and when a frame is
+// drawn, and sleeps in between. The camera follows the missile;
+// the physics doesn't care whether it's in view. A shot still flying
+// after maxsteps ends there, as the server or recording ended it.
+int fireproj(const Layout & layout, bool player, double v1, double vtheta, FrameTimer & timer, Camera & camera, int maxsteps) {
+  Shot shot(layout, v1, vtheta, player ? 1 : 0);    // The missile starts at the current player's planet
+  Missile shown = shot.getmissile();                // Where the missile was last drawn
+  bool drawn = false;
+  int outcome = SHOT_FLYING;
+  timer.start();
+  while (outcome == SHOT_FLYING && shot.getsteps() < maxsteps) {
+    {
+      PROFILE_SCOPE(PROF_FRAME);
+      int due = timer.stepsdue();
+      for (int k = 0; k < due && outcome == SHOT_FLYING && shot.getsteps() < maxsteps; ++k) {
+        outcome = shot.step();
+      }
+      if (due && timer.renderdue()) {
+        if (drawn)
+          erasemissile(shown);
+        shown = shot.getmissile();
+        if (camera.follow(shown.getx(), shown.gety()))
+          drawboard(layout, camera, player);
+        printmissile(shown);
+        presentframe();                             // One update per frame; the erase goes out with the next one
+        drawn = true;
       }
+      timer.sleep();                                // Also leaves the final position up for a step
     }
+    PROFILE_FRAME();
   }
-
-  // Construct the planets
-  for (int i = 0; i < num; ++i) {
-    planets[i] = Planet(x[i], y[i], s[i]);
-  }
+  if (drawn)
+    erasemissile(shown);
+  presentframe();
+  return shot.gethit();
 }
 
-// Returns true if the missile goes out of bounds
-bool checkSides(Missile* Projectile, int cols, int lines) {
-  int mx = Projectile->getx();
-  int my = Projectile->gety();
-  if ((mx < (cols-2)) && (mx >1)) {
-    if ((my < (lines-3)) && (my > 2)) {
-      return false;
-    }
-    else {
-      return true;
-    }
-  }
-  else {
+bool checkreplay(const Replay & replay, const int * score) {
+  if (!replay.finished) {
+    cout << "the recording stops before the end of the game; no final score to check" << endl;
     return true;
   }
+  if (score[0] != replay.score[0] || score[1] != replay.score[1]) {
+    cout << "score doesn't match the recording, which ended " << replay.score[0] << " - " << replay.score[1] << endl;
+    return false;
+  }
+  cout << "score matches the recording" << endl;
+  return true;
 }
 
-// Abstracts away the functions needed to fire the missile.
-// Makes the loop in the main function simpler and easier to
-// debug.
-Body * fireproj(Missile* missile1, Body * head, bool player, int nlines, int ncols) {
-  Body * collided = NULL;
-  while (!collided) {
-    bool sidecoll = false;
-    double missileforce[2];
-    missile1->getforce(head, missileforce);             // Part of the Body class. Calculates the force from all the other bodies' gravity
-    missile1->setvelocity(missileforce);                // Part of the Body class. Sets velocity using dv = F/m dt
-    missile1->movebody();                               // Part of the Body class. Moves the body according to its velocity
-    collided = checkcollision(missile1, head);
-    missile1->printbody();
-    wait(100);
-    missile1->erasebody();
-    sidecoll = checkSides(missile1, ncols, nlines);
-    if (sidecoll == true) {
-      break;
+// Animates a salvo. Every missile moves each step, and each frame
+// erases the whole salvo where it was last drawn and draws it again,
+// in one update. Missiles still flying after maxsteps are dropped, so
+// one caught in an orbit can't hold up the game. The camera stays
+// put; missiles outside its window fly on undrawn. shown is scratch
+// space for the cells drawn last frame, x then y.
+int firesalvo(Salvo & salvo, vector<int> & shown, bool player, double v1, double vtheta, FrameTimer & timer, int n, double spread, int maxsteps) {
+  salvo.clear();
+  salvo.firespread(n, v1, vtheta, spread, player ? 1 : 0);
+  shown.clear();
+  int steps = 0;
+  timer.start();
+  while (salvo.flying() > 0) {
+    {
+      PROFILE_SCOPE(PROF_FRAME);
+      int due = timer.stepsdue();
+      for (int k = 0; k < due && salvo.flying() > 0; ++k) {
+        salvo.step();
+        if (++steps >= maxsteps)
+          salvo.stop();
+      }
+      if (due && timer.renderdue()) {
+        for (size_t c = 0; c < shown.size(); c += 2)
+          erasemissileat(shown[c], shown[c + 1]);
+        shown.clear();
+        for (int k = 0; k < salvo.flying(); ++k) {
+          shown.push_back(salvo.flyingcellx(k));
+          shown.push_back(salvo.flyingcelly(k));
+          printmissileat(shown[2 * k], shown[2 * k + 1]);
+        }
+        presentframe();
       }
+      timer.sleep();
     }
-  return collided;
+    PROFILE_FRAME();
+  }
+  for (size_t c = 0; c < shown.size(); c += 2)
+    erasemissileat(shown[c], shown[c + 1]);
+  presentframe();
+
+  int hits = 0;
+  for (int i = 0; i < salvo.count(); ++i)
+    hits += (salvo.gethit(salvo.missile(i)) == (player ? 0 : 1));
+  return hits;
+}
+
+// Shows on the line above the prompts whether the other player is
+// taking their turn, and clears it when it's this player's
+void printwaiting(bool mine, int nlines, int ncols) {
+  char waittext[] = "Waiting for the other player...";
+  wmove(stdscr, nlines - 2, 0);
+  clrtoeol();
+  if (!mine) {
+    wmove(stdscr, nlines - 2, (ncols / 2) - (strlen(waittext) / 2));
+    addstr(waittext);
+  }
+  presentframe();
 }
 
 // Uses ncurses.h to print the players' scores. Also uses an
@@ -0,0 +1,171 @@
+/*
+ * bpserver
+ *
+ * Referees one networked game. Waits for two players to connect
+ * with "battleplanets --connect host:port", tells each the settings
+ * and which player it is, then plays their turns on a Match and sends
+ * both of them every result. Runs headless on the simulation core.
+ *
+ */
+
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <poll.h>
+#include <unistd.h>
+#include "Sim.h"
+#include "Replay.h"
+#include "Match.h"
+#include "Net.h"
+
+using namespace std;
+
+int main(int argc, char * argv[]) {
+  if (argc < 2) {
+    cerr << "usage: " << argv[0] << " port [--max-steps n] [--seed n] [--world lines cols] [--integrator name] [--force-law name]"
+         << " [--tolerance t] [--swept] [--theta t] [--field-grid res] [--salvo n] [--spread deg]"
+         << " [--record file]" << endl;
+    return 1;
+  }
+  int port = atoi(argv[1]);
+  uint64_t seed = time(NULL);
+  int nlines = 50, ncols = 160;          // The field; each player sees it through their own terminal
+  int salvosize = 0;
+  double spread = 30;
+  bool usegrid = false;
+  int maxsteps = 100000;                 // Far longer than any shot that lands
+  const char * recordname = NULL;
+  Layout layout;                         // Only holds the settings; the Match builds its own
+  for (int i = 2; i < argc; ++i) {
+    if (!strcmp(argv[i], "--max-steps") && i + 1 < argc) {
+      maxsteps = atoi(argv[++i]);
+    }
+    else if (!strcmp(argv[i], "--seed") && i + 1 < argc) {
+      seed = strtoull(argv[++i], NULL, 10);
+    }
+    else if (!strcmp(argv[i], "--world") && i + 2 < argc) {
+      nlines = atoi(argv[++i]);
+      ncols = atoi(argv[++i]);
+    }
+    else if (!strcmp(argv[i], "--integrator") && i + 1 < argc && parseintegrator(argv[i + 1]) >= 0) {
+      layout.integrator = parseintegrator(argv[++i]);
+    }
+    else if (!strcmp(argv[i], "--force-law") && i + 1 < argc && parseforcelaw(argv[i + 1]) >= 0) {
+      layout.forcelaw = parseforcelaw(argv[++i]);
+    }
+    else if (!strcmp(argv[i], "--tolerance") && i + 1 < argc) {
+      layout.tolerance = atof(argv[++i]);
+    }
+    else if (!strcmp(argv[i], "--swept")) {
+      layout.swept = true;
+    }
+    else if (!strcmp(argv[i], "--theta") && i + 1 < argc) {
+      layout.tree.settheta(atof(argv[++i]));
+    }
+    else if (!strcmp(argv[i], "--field-grid") && i + 1 < argc) {
+      usegrid = true;
+      layout.grid.setresolution(atoi(argv[++i]));
+    }
+    else if (!strcmp(argv[i], "--salvo") && i + 1 < argc) {
+      salvosize = atoi(argv[++i]);
+    }
+    else if (!strcmp(argv[i], "--spread") && i + 1 < argc) {
+      spread = atof(argv[++i]);
+    }
+    else if (!strcmp(argv[i], "--record") && i + 1 < argc) {
+      recordname = argv[++i];
+    }
+    else {
+      cerr << "unknown option " << argv[i] << endl;
+      return 1;
+    }
+  }
+
+  if (maxsteps < MAXSTEPS)
+    maxsteps = MAXSTEPS;
+  if (salvosize > 1 && layout.integrator != INTEGRATE_EULER) {
+    cerr << "--salvo flies Euler steps; it can't be used with --integrator verlet or rk45" << endl;
+    return 1;
+  }
+
+  ReplayHeader game = replayheader(layout, seed, nlines, ncols, usegrid, salvosize, spread);
+  game.maxsteps = maxsteps;              // Both players fly their shots to the same limit
+  if (!validheader(game)) {
+    cerr << "the field size, salvo, grid resolution, tolerance, theta or spread is out of range" << endl;
+    return 1;
+  }
+  if (!fieldplayable(game)) {
+    cerr << "a " << nlines << " by " << ncols << " field is too small for the players' planets" << endl;
+    return 1;
+  }
+  ReplayWriter recorder;
+  if (recordname && !recorder.open(recordname, game)) {
+    cerr << "can't write " << recordname << endl;
+    return 1;
+  }
+
+  int listener = netlisten(port);
+  if (listener < 0) {
+    perror("listen");
+    return 1;
+  }
+  cout << "waiting for players on port " << port << endl;
+  int fd[2];
+  for (int p = 0; p < 2; ++p) {
+    fd[p] = netaccept(listener);
+    if (fd[p] < 0) {
+      perror("accept");
+      return 1;
+    }
+    cout << "player " << p + 1 << " connected" << endl;
+  }
+  close(listener);
+  for (int p = 0; p < 2; ++p) {          // The game starts once both are here
+    if (!sendhello(fd[p], p, game)) {
+      cerr << "player " << p + 1 << " hung up" << endl;
+      return 1;
+    }
+  }
+
+  // Only the player whose turn it is may send anything. Hearing from
+  // the other one means it hung up or broke the protocol, and either
+  // way the game is over.
+  Match match(game);
+  long turns = 0, bytes = 0;
+  bool ok = true;
+  while (ok && !match.isover()) {
+    int mover = match.getplayer();
+    pollfd wait[2] = {{fd[0], POLLIN, 0}, {fd[1], POLLIN, 0}};
+    if (poll(wait, 2, -1) < 0 || wait[!mover].revents) {
+      ok = false;
+      break;
+    }
+    NetTurn turn;
+    if (!recvturn(fd[mover], &turn)) {
+      ok = false;
+      break;
+    }
+    TurnResult result = match.play(turn.action, turn.speed, turn.angle);
+    if (turn.action == REPLAY_NEW || turn.action == REPLAY_FIRE)
+      recorder.turn(turn.action, turn.speed, turn.angle);
+    ok = sendresult(fd[0], result) && sendresult(fd[1], result);
+    bytes += sizeof(turn) + 2 * sizeof(result);
+    ++turns;
+  }
+  if (!ok) {
+    TurnResult quit = match.play(REPLAY_QUIT, 0, 0);
+    sendresult(fd[0], quit);              // Whoever is still there hears the game is over
+    sendresult(fd[1], quit);
+    cout << "a player disconnected" << endl;
+  }
+  recorder.finish(match.getscore());
+  close(fd[0]);
+  close(fd[1]);
+
+  cout << "turns " << turns << "  shots " << match.getshots()
+       << "  score " << match.getscore()[0] << " - " << match.getscore()[1]
+       << "  bytes/turn " << (turns ? bytes / turns : 0) << endl;
+  return 0;
+}
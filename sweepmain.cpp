@@ -0,0 +1,164 @@
+/*
+ * sweep
+ *
+ * Fires every (angle, speed) pair in the game's ranges at one
+ * planet layout and writes out a hit map. Runs headless on the
+ * simulation core, spread over every core.
+ *
+ */
+
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <ctime>
+#include "Sim.h"
+#include "Sweep.h"
+#include "Scheduler.h"
+#include "Profile.h"
+#include "Trajectory.h"
+
+using namespace std;
+
+static double seconds(chrono::steady_clock::time_point start) {
+  return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char * argv[]) {
+  if (argc < 3) {
+    cerr << "usage: " << argv[0] << " lines cols [--angles n] [--speeds n] [--threads n]"
+         << " [--band n] [--shooter p] [--seed n] [--integrator name] [--force-law name] [--tolerance t]"
+         << " [--swept] [--scaling] [--trajectory file] [--salvo n] [-o file]" << endl;
+    return 1;
+  }
+  int nlines = atoi(argv[1]);
+  int ncols = atoi(argv[2]);
+  SweepSpec spec = defaultsweep(3600, 101);
+  const char * outname = NULL;
+  const char * trajname = NULL;
+  int salvosize = 0;
+  bool scaling = false;
+  Layout layout;
+  PROFILE_START(getenv("BP_PROFILE_FILE"));
+  uint64_t seed = time(NULL);
+  for (int i = 3; i < argc; ++i) {
+    if (!strcmp(argv[i], "--angles") && i + 1 < argc)
+      spec.nangles = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "--speeds") && i + 1 < argc)
+      spec.nspeeds = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "--threads") && i + 1 < argc)
+      spec.threads = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "--band") && i + 1 < argc)
+      spec.band = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "--shooter") && i + 1 < argc)
+      spec.shooter = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "--seed") && i + 1 < argc)
+      seed = strtoull(argv[++i], NULL, 10);
+    else if (!strcmp(argv[i], "--integrator") && i + 1 < argc && parseintegrator(argv[i + 1]) >= 0)
+      layout.integrator = parseintegrator(argv[++i]);
+    else if (!strcmp(argv[i], "--force-law") && i + 1 < argc && parseforcelaw(argv[i + 1]) >= 0)
+      layout.forcelaw = parseforcelaw(argv[++i]);
+    else if (!strcmp(argv[i], "--tolerance") && i + 1 < argc)
+      layout.tolerance = atof(argv[++i]);
+    else if (!strcmp(argv[i], "--swept"))
+      layout.swept = true;
+    else if (!strcmp(argv[i], "--scaling"))
+      scaling = true;
+    else if (!strcmp(argv[i], "-o") && i + 1 < argc)
+      outname = argv[++i];
+    else if (!strcmp(argv[i], "--trajectory") && i + 1 < argc)
+      trajname = argv[++i];
+    else if (!strcmp(argv[i], "--salvo") && i + 1 < argc)
+      salvosize = atoi(argv[++i]);
+    else {
+      cerr << "unknown option " << argv[i] << endl;
+      return 1;
+    }
+  }
+  if (spec.shooter != 0 && spec.shooter != 1) {
+    cerr << "--shooter must be 0 or 1" << endl;
+    return 1;
+  }
+  if (salvosize > 0 && layout.integrator != INTEGRATE_EULER) {
+    cerr << "--salvo flies Euler steps; it can't be used with --integrator verlet or rk45" << endl;
+    return 1;
+  }
+  if (trajname && salvosize > 0) {
+    cerr << "--trajectory records single shots; it can't be used with --salvo" << endl;   // Salvo steps don't go through Shot
+    return 1;
+  }
+
+  LayoutStats placed = arrangeplanets(layout, planetcount(nlines, ncols), nlines, ncols, seed);
+  if (placed.placed < 2) {
+    cerr << "a " << nlines << " by " << ncols << " field is too small for the players' planets" << endl;
+    return 1;
+  }
+  int target = (spec.shooter == 0 ? 1 : 0);
+
+  // --scaling runs the same sweep on 1, 2, 4 ... threads up to the
+  // core count and reports the speedup over one thread
+  if (scaling) {
+    double base = 0;
+    for (int t = 1; ; t *= 2) {
+      if (t > corecount())
+        t = corecount();
+      spec.threads = t;
+      chrono::steady_clock::time_point start = chrono::steady_clock::now();
+      sweep(layout, spec);
+      double elapsed = seconds(start);
+      if (t == 1)
+        base = elapsed;
+      printf("threads %3d  %8.3fs  speedup %5.2f\n", t, elapsed, base / elapsed);
+      if (t == corecount())
+        break;
+    }
+    return 0;
+  }
+
+  // --trajectory records every step of every shot
+  TrajectorySink trajectory;
+  if (trajname) {
+    if (!trajectory.open(trajname, seed)) {
+      cerr << "could not write " << trajname << endl;
+      return 1;
+    }
+    layout.trajectory = &trajectory;
+  }
+
+  chrono::steady_clock::time_point start = chrono::steady_clock::now();
+  HitMap map = (salvosize > 0 ? sweepsalvo(layout, spec, salvosize) : sweep(layout, spec));   // --salvo n flies n missiles at once
+  double elapsed = seconds(start);
+  if (trajname) {
+    trajectory.close();
+    layout.trajectory = NULL;
+  }
+
+  long shots = map.hit.size();
+  long steps = 0, targethits = 0, anyhits = 0;
+  for (long k = 0; k < shots; ++k) {
+    steps += map.steps[k];
+    anyhits += (map.hit[k] >= 0);
+    targethits += (map.hit[k] == target);
+  }
+  printf("seed %llu  bodies %d of %d  fill %.3f\n", (unsigned long long)seed, placed.placed,
+         placed.requested, placed.fill);
+  printf("shots %ld  steps %ld  threads %d\n", shots, steps,
+         spec.threads > 0 ? spec.threads : corecount());
+  printf("hits %ld  on target %ld\n", anyhits, targethits);
+  printf("%.3fs  %.0f shots/s\n", elapsed, shots / elapsed);
+  if (trajname)
+    printf("trajectory records %ld  dropped %ld\n", trajectory.getwritten(), trajectory.getdropped());
+
+  if (outname) {
+    FILE * out = fopen(outname, "wb");
+    bool ok = (out && writehitmap(map, out));
+    if (out && fclose(out) != 0)
+      ok = false;
+    if (!ok) {
+      cerr << "could not write " << outname << endl;
+      return 1;
+    }
+  }
+  return 0;
+}
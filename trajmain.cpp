@@ -0,0 +1,76 @@
+/*
+ * trajread
+ *
+ * Reads back a trajectory file written with --trajectory, a record
+ * at a time, so it costs the same memory however big the file is.
+ * Prints a summary, or the records themselves as CSV.
+ *
+ */
+
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include "Trajectory.h"
+
+using namespace std;
+
+int main(int argc, char * argv[]) {
+  if (argc < 2) {
+    cerr << "usage: " << argv[0] << " file [--csv] [--shot n]" << endl;
+    return 1;
+  }
+  bool csv = false;
+  long onlyshot = -1;
+  for (int i = 2; i < argc; ++i) {
+    if (!strcmp(argv[i], "--csv"))
+      csv = true;
+    else if (!strcmp(argv[i], "--shot") && i + 1 < argc) {
+      onlyshot = atol(argv[++i]);
+      csv = true;
+    }
+    else {
+      cerr << "unknown option " << argv[i] << endl;
+      return 1;
+    }
+  }
+
+  TrajectoryReader reader;
+  if (!reader.open(argv[1])) {
+    cerr << argv[1] << " isn't a trajectory file" << endl;
+    return 1;
+  }
+
+  if (csv)
+    printf("shot,step,x,y,vx,vy,fx,fy,nearest,distance\n");
+
+  long records = 0;
+  long shots = 0;               // Highest shot number seen, plus one
+  long maxsteps = 0;
+  double maxspeed = 0;
+  double closest = HUGE_VAL;
+  const TrajectoryRecord * r;
+  while ((r = reader.next()) != NULL) {
+    if (csv) {
+      if (onlyshot < 0 || r->shot == onlyshot)
+        printf("%u,%u,%g,%g,%g,%g,%g,%g,%d,%g\n", r->shot, r->step, r->x, r->y,
+               r->vx, r->vy, r->fx, r->fy, r->nearest, r->distance);
+      continue;
+    }
+    ++records;
+    if (r->shot >= shots)
+      shots = r->shot + 1;
+    if (r->step > maxsteps)
+      maxsteps = r->step;
+    maxspeed = fmax(maxspeed, sqrt(r->vx * r->vx + r->vy * r->vy));
+    closest = fmin(closest, r->distance);
+  }
+  if (csv)
+    return 0;
+
+  const TrajectoryHeader & h = reader.getheader();
+  printf("seed %llu  records %ld of %ld  shots %ld\n", (unsigned long long)h.seed, records, reader.count(), shots);
+  printf("longest shot %ld steps  fastest %.3f  closest approach %.3f\n", maxsteps, maxspeed, closest);
+  return 0;
+}